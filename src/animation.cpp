@@ -17,6 +17,10 @@
 
 #include "animation.h"
 #include "animationcurve.h"
+#include "animationgovernor.h"
+#include "springanimation.h"
+
+bool Animation::s_instant = false;
 
 Animation::Animation()
          : updateSignal(new Signal<float>())
@@ -25,11 +29,13 @@ Animation::Animation()
 {
     m_animation.parent = this;
     wl_list_init(&m_animation.ani.link);
-    m_animation.ani.frame = [](struct weston_animation *base, struct weston_output *output, uint32_t msecs) {
-        AnimWrapper *animation = container_of(base, AnimWrapper, ani);
-        animation->parent->update(output, msecs);
-    };
+    m_animation.ani.frame = frame;
+}
 
+void Animation::frame(struct weston_animation *base, struct weston_output *output, uint32_t msecs)
+{
+    AnimWrapper *animation = container_of(base, AnimWrapper, ani);
+    animation->parent->update(output, msecs);
 }
 
 Animation::~Animation()
@@ -37,6 +43,7 @@ Animation::~Animation()
     stop();
     updateSignal->flush();
     doneSignal->flush();
+    delCurve();
 }
 
 void Animation::setStart(float value)
@@ -53,7 +60,19 @@ void Animation::run(struct weston_output *output, uint32_t duration, Animation::
 {
     stop();
 
-    if (!output) {
+    AnimationGovernor *governor = AnimationGovernor::instance();
+    governor->animationStarted();
+    AnimationGovernor::Profile profile = governor->profile();
+    if (profile == AnimationGovernor::Profile::Short) {
+        duration /= 2;
+    } else if (profile == AnimationGovernor::Profile::NoAlpha) {
+        duration /= 2;
+        if ((int)flags & (int)Flags::Alpha) {
+            profile = AnimationGovernor::Profile::Instant;
+        }
+    }
+
+    if (!output || s_instant || profile == AnimationGovernor::Profile::Instant) {
         (*updateSignal)(m_target);
         if ((int)flags & (int)Flags::SendDone) {
             (*doneSignal)();
@@ -79,6 +98,58 @@ void Animation::stop()
     }
 }
 
+void Animation::finish()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    stop();
+    (*updateSignal)(m_target);
+    if ((int)Flags::SendDone & (int)m_runFlags) {
+        (*doneSignal)();
+    }
+}
+
+void Animation::finishAll(struct weston_output *output)
+{
+    // The done handlers may start or stop other animations, so look for
+    // the next one from the start every time. Bound the loop, in case
+    // some animation restarts itself when done. The springs are finished
+    // too, the other animations in the list are left alone.
+    for (int n = wl_list_length(&output->animation_list); n > 0; --n) {
+        Animation *next = nullptr;
+        SpringAnimation *spring = nullptr;
+        struct weston_animation *a;
+        wl_list_for_each(a, &output->animation_list, link) {
+            if (a->frame == frame) {
+                next = container_of(a, AnimWrapper, ani)->parent;
+                break;
+            }
+            if ((spring = SpringAnimation::fromAnimation(a))) {
+                break;
+            }
+        }
+        if (next) {
+            next->finish();
+        } else if (spring) {
+            spring->finish();
+        } else {
+            return;
+        }
+    }
+}
+
+void Animation::setInstant(bool instant)
+{
+    s_instant = instant;
+}
+
+bool Animation::isInstant()
+{
+    return s_instant || AnimationGovernor::instance()->profile() == AnimationGovernor::Profile::Instant;
+}
+
 bool Animation::isRunning() const
 {
     //can't use wl_list_empty here because it wants a wl_link* while i have a const wl_link*
@@ -87,12 +158,27 @@ bool Animation::isRunning() const
 
 void Animation::update(struct weston_output *output, uint32_t msecs)
 {
+    AnimationGovernor::instance()->frame(output, msecs);
+
+    // msecs is when the last frame was presented, the one being drawn now
+    // will be shown at the next vblank, one refresh period later. The
+    // animation starts from what was on screen at the last presentation
+    // before its first frame, so that frame already shows some progress.
+    // The refresh is in mHz.
+    int32_t refresh = output->current_mode && output->current_mode->refresh > 0 ? output->current_mode->refresh : 60000;
+    uint32_t presentation = msecs + 1000000 / refresh;
     if (m_animation.ani.frame_counter <= 1) {
         m_timestamp = msecs;
+    } else if (presentation == m_lastPresentation) {
+        // A second repaint for the same vblank, what it would show is
+        // already queued.
+        weston_compositor_schedule_repaint(output->compositor);
+        return;
     }
+    m_lastPresentation = presentation;
 
-    uint32_t time = msecs - m_timestamp;
-    if (time > m_duration) {
+    uint32_t time = presentation - m_timestamp;
+    if (time >= m_duration) {
         (*updateSignal)(m_target);
         stop();
         weston_compositor_schedule_repaint(output->compositor);
@@ -106,7 +192,11 @@ void Animation::update(struct weston_output *output, uint32_t msecs)
     if (m_curve) {
         f = m_curve->value(f);
     }
-    (*updateSignal)(m_target * f + m_start * (1.f - f));
+    float value = m_target * f + m_start * (1.f - f);
+    if (m_animation.ani.frame_counter <= 1 || value != m_lastValue) {
+        m_lastValue = value;
+        (*updateSignal)(value);
+    }
 
     weston_compositor_schedule_repaint(output->compositor);
 }
@@ -21,15 +21,19 @@
 #include <weston/compositor.h>
 
 #include "shellsignal.h"
+#include "objectstats.h"
 
 class ShellSurface;
 class AnimationCurve;
 
-class Animation {
+class Animation : public Counted<Animation> {
 public:
     enum class Flags {
         None = 0,
-        SendDone = 1
+        SendDone = 1,
+        // The animation only fades something, it can be skipped when
+        // frames are expensive. See AnimationGovernor.
+        Alpha = 2
     };
     Animation();
     ~Animation();
@@ -39,6 +43,11 @@ public:
     void setTarget(float value);
     void run(struct weston_output *output, uint32_t duration, Flags flags = Flags::None);
     void stop();
+    /*
+     * Jumps to the target value, sending done if the animation was run
+     * with Flags::SendDone.
+     */
+    void finish();
     bool isRunning() const;
     template<class T>
     void setCurve(const T &curve) { delCurve(); m_curve = new T; *static_cast<T *>(m_curve) = curve; }
@@ -46,7 +55,22 @@ public:
     Signal<float> *updateSignal;
     Signal<> *doneSignal;
 
+    /*
+     * Finishes the Animations and the SpringAnimations running on output.
+     */
+    static void finishAll(struct weston_output *output);
+    /*
+     * When set, the animations jump straight to their target when run.
+     */
+    static void setInstant(bool instant);
+    /*
+     * Whether the animations are instant right now, because of
+     * setInstant() or of the AnimationGovernor.
+     */
+    static bool isInstant();
+
 private:
+    static void frame(struct weston_animation *base, struct weston_output *output, uint32_t msecs);
     void update(struct weston_output *output, uint32_t msecs);
     void delCurve();
 
@@ -59,12 +83,16 @@ private:
     float m_target;
     uint32_t m_duration;
     uint32_t m_timestamp;
+    uint32_t m_lastPresentation;
+    float m_lastValue;
     Flags m_runFlags;
     AnimationCurve *m_curve;
+
+    static bool s_instant;
 };
 
 inline Animation::Flags operator|(Animation::Flags a, Animation::Flags b) {
-    return (Animation::Flags)(a | b);
+    return (Animation::Flags)((int)a | (int)b);
 }
 
 #endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <weston/compositor.h>
+
+#include "animationgovernor.h"
+
+// The number of frames the missed ones are counted over.
+static const int Window = 30;
+// Frames further apart than this belong to different animations.
+static const uint32_t MaxFrameInterval = 250;
+// How long to stay in the Instant profile before trying animations again.
+static const uint32_t InstantProbeDelay = 2000;
+
+AnimationGovernor *AnimationGovernor::instance()
+{
+    static AnimationGovernor *governor = new AnimationGovernor;
+    return governor;
+}
+
+AnimationGovernor::AnimationGovernor()
+                 : m_profile(Profile::Full)
+                 , m_profileChanged(0)
+                 , m_enabled(true)
+                 , m_budget(150)
+                 , m_degradeThreshold(20)
+                 , m_recoverThreshold(5)
+{
+}
+
+void AnimationGovernor::frame(weston_output *output, uint32_t msecs)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    auto it = m_outputs.find(output);
+    if (it == m_outputs.end()) {
+        m_outputs[output] = { msecs, 0, 0 };
+        return;
+    }
+
+    OutputFrames &f = it->second;
+    uint32_t interval = msecs - f.last;
+    if (interval == 0) {
+        // Another animation on the same frame.
+        return;
+    }
+    f.last = msecs;
+    if (interval > MaxFrameInterval) {
+        return;
+    }
+
+    // The refresh is in mHz, the budget in percent of the period.
+    int32_t refresh = output->current_mode && output->current_mode->refresh > 0 ? output->current_mode->refresh : 60000;
+    uint32_t budget = 10000 * m_budget / refresh;
+    ++f.frames;
+    if (interval > budget) {
+        ++f.missed;
+    }
+    if (f.frames < Window) {
+        return;
+    }
+
+    int missed = f.missed * 100 / f.frames;
+    f.frames = 0;
+    f.missed = 0;
+    if (missed >= m_degradeThreshold && m_profile != Profile::Instant) {
+        setProfile((Profile)((int)m_profile + 1));
+    } else if (missed <= m_recoverThreshold && m_profile != Profile::Full) {
+        setProfile((Profile)((int)m_profile - 1));
+    }
+}
+
+void AnimationGovernor::animationStarted()
+{
+    if (m_profile == Profile::Instant && weston_compositor_get_time() - m_profileChanged > InstantProbeDelay) {
+        setProfile(Profile::NoAlpha);
+    }
+}
+
+void AnimationGovernor::setProfile(Profile profile)
+{
+    static const char *names[] = { "full", "short", "no alpha", "instant" };
+    weston_log("nuclear: animation profile '%s'\n", names[(int)profile]);
+
+    m_profile = profile;
+    m_profileChanged = weston_compositor_get_time();
+    // Start counting again, the frames so far were with the old profile.
+    m_outputs.clear();
+}
+
+void AnimationGovernor::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled && m_profile != Profile::Full) {
+        setProfile(Profile::Full);
+    }
+}
+
+void AnimationGovernor::setFrameBudget(int budget)
+{
+    m_budget = budget > 100 ? budget : 100;
+}
+
+void AnimationGovernor::setDegradeThreshold(int threshold)
+{
+    m_degradeThreshold = threshold;
+}
+
+void AnimationGovernor::setRecoverThreshold(int threshold)
+{
+    m_recoverThreshold = threshold;
+}
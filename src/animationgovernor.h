@@ -0,0 +1,90 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMATIONGOVERNOR_H
+#define ANIMATIONGOVERNOR_H
+
+#include <stdint.h>
+
+#include <unordered_map>
+
+struct weston_output;
+
+/*
+ * Watches the frame times of the outputs while animations are running
+ * and picks a cheaper animation profile when too many frames miss their
+ * budget, going back one step at a time when they stop missing it.
+ * The profiles are, from the most expensive: Full, Short, with halved
+ * durations, NoAlpha, which also makes the alpha animations instant,
+ * and Instant. Configured by the "animations" settings.
+ */
+class AnimationGovernor
+{
+public:
+    enum class Profile {
+        Full = 0,
+        Short = 1,
+        NoAlpha = 2,
+        Instant = 3
+    };
+
+    static AnimationGovernor *instance();
+
+    inline Profile profile() const { return m_profile; }
+
+    /*
+     * Called by the animations on every frame of output, at most once
+     * per frame is taken into account.
+     */
+    void frame(weston_output *output, uint32_t msecs);
+    /*
+     * Called when an animation is started. In the Instant profile no
+     * frames come, so this is where it checks whether it can go back.
+     */
+    void animationStarted();
+
+    void setEnabled(bool enabled);
+    /*
+     * In percent of the refresh period of the output.
+     */
+    void setFrameBudget(int budget);
+    /*
+     * In percent of the frames of a window which missed the budget.
+     */
+    void setDegradeThreshold(int threshold);
+    void setRecoverThreshold(int threshold);
+
+private:
+    AnimationGovernor();
+    void setProfile(Profile profile);
+
+    struct OutputFrames {
+        uint32_t last;
+        int frames;
+        int missed;
+    };
+
+    std::unordered_map<weston_output *, OutputFrames> m_outputs;
+    Profile m_profile;
+    uint32_t m_profileChanged;
+    bool m_enabled;
+    int m_budget;
+    int m_degradeThreshold;
+    int m_recoverThreshold;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "animationgovernor.h"
+#include "settings.h"
+
+// Kept apart from the governor, which can then be built without the
+// settings machinery.
+
+class AnimationSettings : public Settings
+{
+public:
+    virtual std::list<Option> options() const override
+    {
+        std::list<Option> list;
+        list.push_back(Option::integer("governor"));
+        list.push_back(Option::integer("frame_budget"));
+        list.push_back(Option::integer("degrade_threshold"));
+        list.push_back(Option::integer("recover_threshold"));
+        return list;
+    }
+
+    virtual void unSet(const std::string &name) override
+    {
+        AnimationGovernor *g = AnimationGovernor::instance();
+        if (name == "governor") {
+            g->setEnabled(true);
+        } else if (name == "frame_budget") {
+            g->setFrameBudget(150);
+        } else if (name == "degrade_threshold") {
+            g->setDegradeThreshold(20);
+        } else if (name == "recover_threshold") {
+            g->setRecoverThreshold(5);
+        }
+    }
+
+    virtual void set(const std::string &name, int v) override
+    {
+        AnimationGovernor *g = AnimationGovernor::instance();
+        if (name == "governor") {
+            g->setEnabled(v);
+        } else if (name == "frame_budget") {
+            g->setFrameBudget(v);
+        } else if (name == "degrade_threshold") {
+            g->setDegradeThreshold(v);
+        } else if (name == "recover_threshold") {
+            g->setRecoverThreshold(v);
+        }
+    }
+};
+
+SETTINGS(animations, AnimationSettings)
@@ -61,10 +61,11 @@ void Binding::releaseToggle()
     }
 }
 
+// While locked the input only goes to the lock surface.
 void Binding::keyHandler(weston_seat *seat, uint32_t time, uint32_t key, void *data)
 {
     Binding *b = static_cast<Binding *>(data);
-    if (b->checkToggled()) {
+    if (!Shell::instance()->isLocked() && b->checkToggled()) {
         b->keyTriggered(seat, time, key);
     }
 }
@@ -72,14 +73,16 @@ void Binding::keyHandler(weston_seat *seat, uint32_t time, uint32_t key, void *d
 void Binding::buttonHandler(weston_seat *seat, uint32_t time, uint32_t button, void *data)
 {
     Binding *b = static_cast<Binding *>(data);
-    if (b->checkToggled()) {
+    if (!Shell::instance()->isLocked() && b->checkToggled()) {
         b->buttonTriggered(seat, time, button);
     }
 }
 
 static void axisHandler(weston_seat *seat, uint32_t time, uint32_t axis, wl_fixed_t value, void *data)
 {
-    static_cast<Binding *>(data)->axisTriggered(seat, time, axis, value);
+    if (!Shell::instance()->isLocked()) {
+        static_cast<Binding *>(data)->axisTriggered(seat, time, axis, value);
+    }
 }
 
 void Binding::bindKey(uint32_t key, weston_keyboard_modifier modifier)
@@ -120,7 +123,7 @@ void Binding::bindHotSpot(HotSpot hs)
 
 void Binding::hotSpotHandler(weston_seat *seat, uint32_t time, HotSpot hs)
 {
-    if (checkToggled()) {
+    if (!Shell::instance()->isLocked() && checkToggled()) {
         hotSpotTriggered(seat, time, hs);
     }
 }
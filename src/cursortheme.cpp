@@ -0,0 +1,302 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include <weston/compositor.h>
+
+#include "cursortheme.h"
+#include "internalclient.h"
+
+static const uint32_t XCURSOR_MAGIC = 0x72756358; // "Xcur"
+static const uint32_t XCURSOR_IMAGE_TYPE = 0xfffd0002;
+static const int MAX_INHERIT_DEPTH = 4;
+
+// The names used by the xcursor themes, in order of preference.
+static const char *const s_cursorNames[][3] = {
+    { nullptr },                                                // None
+    { "top_side", "n-resize", nullptr },                        // ResizeTop
+    { "bottom_side", "s-resize", nullptr },                     // ResizeBottom
+    { "left_ptr", "default", nullptr },                         // Arrow
+    { "left_side", "w-resize", nullptr },                       // ResizeLeft
+    { "top_left_corner", "nw-resize", nullptr },                // ResizeTopLeft
+    { "bottom_left_corner", "sw-resize", nullptr },             // ResizeBottomLeft
+    { "grabbing", "closedhand", nullptr },                      // Move
+    { "right_side", "e-resize", nullptr },                      // ResizeRight
+    { "top_right_corner", "ne-resize", nullptr },               // ResizeTopRight
+    { "bottom_right_corner", "se-resize", nullptr },            // ResizeBottomRight
+    { "watch", "wait", nullptr }                                // Busy
+};
+
+static std::vector<std::string> searchPaths()
+{
+    std::vector<std::string> paths;
+    std::string list;
+
+    if (const char *env = getenv("XCURSOR_PATH")) {
+        list = env;
+    } else {
+        const char *home = getenv("HOME");
+        if (home) {
+            list = std::string(home) + "/.local/share/icons:" + home + "/.icons:";
+        }
+        list += "/usr/share/icons:/usr/share/pixmaps";
+    }
+
+    std::stringstream stream(list);
+    std::string path;
+    while (std::getline(stream, path, ':')) {
+        if (!path.empty()) {
+            paths.push_back(path);
+        }
+    }
+    return paths;
+}
+
+static std::vector<std::string> inheritedThemes(const std::string &theme)
+{
+    std::vector<std::string> themes;
+    for (const std::string &dir: searchPaths()) {
+        std::ifstream file(dir + "/" + theme + "/index.theme");
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, 9, "Inherits=") != 0) {
+                continue;
+            }
+
+            std::stringstream stream(line.substr(9));
+            std::string t;
+            while (std::getline(stream, t, ',')) {
+                t.erase(0, t.find_first_not_of(" \t;"));
+                t.erase(t.find_last_not_of(" \t;\r") + 1);
+                if (!t.empty()) {
+                    themes.push_back(t);
+                }
+            }
+            return themes;
+        }
+    }
+    return themes;
+}
+
+static bool readFile(const std::string &path, std::vector<uint32_t> *data)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 16) {
+        fclose(f);
+        return false;
+    }
+
+    // The xcursor format is made of little endian 32 bit words.
+    data->resize(size / 4);
+    size_t read = fread(data->data(), 4, data->size(), f);
+    fclose(f);
+    return read == data->size();
+}
+
+CursorTheme::CursorTheme(InternalClient *client)
+           : m_client(client)
+{
+    const char *theme = getenv("XCURSOR_THEME");
+    const char *sizeEnv = getenv("XCURSOR_SIZE");
+    int size = sizeEnv ? atoi(sizeEnv) : 0;
+    if (size <= 0) {
+        size = 24;
+    }
+
+    for (int i = 0; i < NumCursors; ++i) {
+        m_images[i].surface = nullptr;
+        if (i == (int)Cursor::None) {
+            continue;
+        }
+
+        Cursor c = (Cursor)i;
+        if (!load(c, theme ? theme : "default", size, 0) && theme) {
+            load(c, "default", size, 0);
+        }
+    }
+}
+
+CursorTheme::~CursorTheme()
+{
+    for (int i = 0; i < NumCursors; ++i) {
+        if (m_images[i].surface) {
+            weston_surface_destroy(m_images[i].surface);
+        }
+    }
+}
+
+bool CursorTheme::load(Cursor cursor, const std::string &theme, int size, int depth)
+{
+    for (const std::string &dir: searchPaths()) {
+        for (const char *const *name = s_cursorNames[(int)cursor]; *name; ++name) {
+            if (loadFile(cursor, dir + "/" + theme + "/cursors/" + *name, size)) {
+                return true;
+            }
+        }
+    }
+
+    if (depth < MAX_INHERIT_DEPTH) {
+        for (const std::string &t: inheritedThemes(theme)) {
+            if (load(cursor, t, size, depth + 1)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CursorTheme::loadFile(Cursor cursor, const std::string &path, int size)
+{
+    std::vector<uint32_t> data;
+    if (!readFile(path, &data) || data[0] != XCURSOR_MAGIC) {
+        return false;
+    }
+
+    uint32_t headerSize = data[1] / 4;
+    uint32_t ntoc = data[3];
+    if (headerSize + ntoc * 3 > data.size()) {
+        return false;
+    }
+
+    // Pick the first image with the nominal size nearest to the requested one.
+    uint32_t position = 0;
+    int bestDistance = -1;
+    for (uint32_t i = 0; i < ntoc; ++i) {
+        const uint32_t *toc = &data[headerSize + i * 3];
+        if (toc[0] != XCURSOR_IMAGE_TYPE) {
+            continue;
+        }
+        int distance = abs((int)toc[1] - size);
+        if (bestDistance < 0 || distance < bestDistance) {
+            bestDistance = distance;
+            position = toc[2] / 4;
+        }
+    }
+    if (bestDistance < 0 || position + 9 > data.size()) {
+        return false;
+    }
+
+    const uint32_t *chunk = &data[position];
+    uint32_t width = chunk[4];
+    uint32_t height = chunk[5];
+    if (chunk[1] != XCURSOR_IMAGE_TYPE || width == 0 || height == 0 || width > 0x7fff || height > 0x7fff ||
+        position + 9 + width * height > data.size()) {
+        return false;
+    }
+
+    void *pixels;
+    int32_t stride;
+    weston_buffer *buffer = m_client->createBuffer(width, height, &pixels, &stride);
+    if (!buffer) {
+        return false;
+    }
+
+    // The xcursor images are premultiplied ARGB, the same as WL_SHM_FORMAT_ARGB8888.
+    const uint32_t *src = chunk + 9;
+    for (uint32_t y = 0; y < height; ++y) {
+        memcpy(static_cast<char *>(pixels) + y * stride, src + y * width, width * 4);
+    }
+
+    weston_surface *surface = m_client->createSurface(buffer, width, height);
+    if (!surface) {
+        wl_resource_destroy(buffer->resource);
+        return false;
+    }
+
+    Image &image = m_images[(int)cursor];
+    image.surface = surface;
+    image.hotspotX = chunk[6];
+    image.hotspotY = chunk[7];
+    return true;
+}
+
+bool CursorTheme::hasCursor(Cursor cursor) const
+{
+    return m_images[(int)cursor].surface;
+}
+
+bool CursorTheme::isOurs(weston_surface *surface) const
+{
+    for (int i = 0; i < NumCursors; ++i) {
+        if (m_images[i].surface == surface) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void unmapSprite(weston_pointer *pointer)
+{
+    weston_view *sprite = pointer->sprite;
+    if (weston_surface_is_mapped(sprite->surface)) {
+        weston_surface_unmap(sprite->surface);
+    }
+
+    wl_list_remove(&pointer->sprite_destroy_listener.link);
+    wl_list_init(&pointer->sprite_destroy_listener.link);
+    sprite->surface->configure = nullptr;
+    sprite->surface->configure_private = nullptr;
+    weston_view_destroy(sprite);
+    pointer->sprite = nullptr;
+}
+
+bool CursorTheme::setCursor(weston_pointer *pointer, Cursor cursor)
+{
+    if (!hasCursor(cursor)) {
+        return false;
+    }
+
+    if (pointer->sprite) {
+        unmapSprite(pointer);
+    }
+
+    // Do what weston does for the client cursors, but without a configure
+    // handler since the surface is never committed.
+    const Image &image = m_images[(int)cursor];
+    wl_signal_add(&image.surface->destroy_signal, &pointer->sprite_destroy_listener);
+    pointer->sprite = weston_view_create(image.surface);
+    pointer->hotspot_x = image.hotspotX;
+    pointer->hotspot_y = image.hotspotY;
+
+    weston_view_set_position(pointer->sprite, wl_fixed_to_int(pointer->x) - image.hotspotX,
+                                              wl_fixed_to_int(pointer->y) - image.hotspotY);
+    weston_layer_entry_insert(&image.surface->compositor->cursor_layer.view_list, &pointer->sprite->layer_link);
+    weston_view_update_transform(pointer->sprite);
+    weston_surface_damage(image.surface);
+    return true;
+}
+
+void CursorTheme::unsetCursor(weston_pointer *pointer)
+{
+    if (pointer->sprite && isOurs(pointer->sprite->surface)) {
+        unmapSprite(pointer);
+    }
+}
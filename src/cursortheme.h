@@ -0,0 +1,67 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CURSORTHEME_H
+#define CURSORTHEME_H
+
+#include <string>
+
+#include "shell.h"
+
+class InternalClient;
+struct weston_pointer;
+struct weston_surface;
+
+/*
+ * The cursors used by the shell grabs, loaded from the xcursor theme once at
+ * startup so that they can be shown without asking the shell client to do it.
+ * The theme and size are taken from XCURSOR_THEME and XCURSOR_SIZE.
+ */
+class CursorTheme
+{
+public:
+    CursorTheme(InternalClient *client);
+    ~CursorTheme();
+
+    bool hasCursor(Cursor cursor) const;
+    /*
+     * Replaces the sprite of the pointer with the cursor. Returns false if
+     * the cursor is not available in the theme.
+     */
+    bool setCursor(weston_pointer *pointer, Cursor cursor);
+    /*
+     * Removes the sprite, if it is one of ours.
+     */
+    void unsetCursor(weston_pointer *pointer);
+
+private:
+    struct Image {
+        weston_surface *surface;
+        int32_t hotspotX;
+        int32_t hotspotY;
+    };
+    static const int NumCursors = (int)Cursor::Busy + 1;
+
+    bool load(Cursor cursor, const std::string &theme, int size, int depth);
+    bool loadFile(Cursor cursor, const std::string &path, int size);
+    bool isOurs(weston_surface *surface) const;
+
+    InternalClient *m_client;
+    Image m_images[NumCursors];
+};
+
+#endif
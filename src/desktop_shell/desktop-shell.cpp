@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <linux/input.h>
 
 #include <wayland-server.h>
@@ -45,7 +46,15 @@
 #include "settingsinterface.h"
 #include "sessionmanager.h"
 #include "dropdown.h"
+#include "keyactions.h"
 #include "screenshooter.h"
+#include "screencast.h"
+#include "windowregistry.h"
+#include "statsinterface.h"
+#include "responsivenessmonitor.h"
+#include "startuptimeline.h"
+#include "splashsnapshot.h"
+#include "idleinhibit.h"
 #include "signal.h"
 
 class Splash {
@@ -57,10 +66,11 @@ public:
     }
     void fadeOut()
     {
+        StartupTimeline::mark("splash_fade_out");
         for (splash *s: splashes) {
             s->fadeAnimation->setStart(1.f);
             s->fadeAnimation->setTarget(0.f);
-            s->fadeAnimation->run(s->view->output, 200, Animation::Flags::SendDone);
+            s->fadeAnimation->run(s->view->output, 200, Animation::Flags::SendDone | Animation::Flags::Alpha);
         }
     }
 
@@ -113,17 +123,57 @@ struct Client {
     WlListener destroyListener;
 };
 
+/*
+ * Pings the shell client through the desktop_shell interface. If it does not
+ * answer in time it is restarted.
+ */
+class DesktopShell::ClientPinger : public ResponsivenessMonitor::Pinger
+{
+public:
+    ClientPinger(DesktopShell *shell, wl_resource *resource)
+        : m_shell(shell)
+        , m_resource(resource)
+    {
+        watch(wl_resource_get_client(resource));
+    }
+
+    using ResponsivenessMonitor::Pinger::handlePong;
+
+protected:
+    void sendPing(uint32_t serial) override
+    {
+        desktop_shell_send_ping(m_resource, serial);
+        wl_client_flush(wl_resource_get_client(m_resource));
+    }
+    void responsivenessChanged() override
+    {
+        if (!isResponsive()) {
+            // This destroys the resource and so the pinger too.
+            m_shell->pingTimerTimeout();
+        }
+    }
+    // It is pinged with no input too, and restarting it is visible, so
+    // give it time to get over a stall, e.g. when it was swapped out.
+    // Only a client hung for this long is restarted.
+    int pingTimeout() const override { return 10000; }
+
+private:
+    DesktopShell *m_shell;
+    wl_resource *m_resource;
+};
+
 DesktopShell::DesktopShell(struct weston_compositor *ec)
             : Shell(ec)
             , m_sessionManager(nullptr)
-            , m_pingTimer(500)
+            , m_splashSnapshot(nullptr)
+            , m_clientPinger(nullptr)
 {
-    m_pingTimer.triggered.connect(this, &DesktopShell::pingTimerTimeout);
 }
 
 DesktopShell::~DesktopShell()
 {
     delete m_splash;
+    delete m_splashSnapshot;
     for (auto value: m_trustedClients) {
         for (Client *c: value.second) {
             delete c;
@@ -159,6 +209,9 @@ DesktopShell::~DesktopShell()
 void DesktopShell::init()
 {
     Shell::init();
+    if (m_splashSnapshot) {
+        m_splashSnapshot->show();
+    }
 
     if (!wl_global_create(compositor()->wl_display, &desktop_shell_interface, 1, this,
         [](struct wl_client *client, void *data, uint32_t version, uint32_t id) { static_cast<DesktopShell *>(data)->bind(client, version, id); }))
@@ -186,7 +239,7 @@ void DesktopShell::init()
     });
     m_quitBinding = new Binding();
     m_quitBinding->keyTriggered.connect([this](weston_seat *seat, uint32_t time, uint32_t key) {
-        Shell::quit();
+        quitWithSnapshot();
     });
 
     if (!wl_global_create(compositor()->wl_display, &desktop_shell_splash_interface, 1, this,
@@ -199,10 +252,15 @@ void DesktopShell::init()
     addInterface(new XWlShell);
     addInterface(new SettingsInterface);
     addInterface(new Dropdown);
+    addInterface(new KeyActions);
     XdgShell *xdg = new XdgShell;
     xdg->surfaceResponsivenessChangedSignal.connect(this, &DesktopShell::surfaceResponsivenessChanged);
     addInterface(xdg);
     addInterface(new Screenshooter);
+    addInterface(new Screencast);
+    addInterface(new WindowRegistry);
+    addInterface(new StatsInterface);
+    addInterface(new IdleInhibit);
 
     m_inputPanel = new InputPanel(compositor()->wl_display);
     m_splash = new Splash;
@@ -210,13 +268,14 @@ void DesktopShell::init()
 
 void DesktopShell::setGrabCursor(Cursor cursor)
 {
-    desktop_shell_send_grab_cursor(m_child.desktop_shell, (uint32_t)cursor);
+    desktop_shell_send_grab_cursor(m_child->desktop_shell, (uint32_t)cursor);
 }
 
 ShellSurface *DesktopShell::createShellSurface(weston_surface *surface, const weston_shell_client *client)
 {
     ShellSurface *s = Shell::createShellSurface(surface, client);
     s->addInterface(new DesktopShellWindow);
+    findInterface<WindowRegistry>()->addSurface(s);
     return s;
 }
 
@@ -267,7 +326,7 @@ void DesktopShell::endBusyCursor(struct weston_seat *seat)
 
 bool DesktopShell::isTrusted(wl_client *client, const char *interface) const
 {
-    if (client == m_child.client) {
+    if (client == m_child->client || (m_standby && client == m_standby->client)) {
         return true;
     }
 
@@ -302,23 +361,18 @@ void DesktopShell::trustedClientDestroyed(void *data)
 
 void DesktopShell::pointerMotion(ShellSeat *seat, weston_pointer *pointer)
 {
-    if (!m_child.desktop_shell || m_pingTimer.isRunning()) {
-        return;
+    // The shell client is pinged on a schedule, here it is only probed if the
+    // user is using one of its surfaces and it has not answered in a while.
+    if (m_child->desktop_shell && pointer->focus && pointer->focus->surface->resource &&
+        wl_resource_get_client(pointer->focus->surface->resource) == shellClient()) {
+        ResponsivenessMonitor::instance()->interaction(shellClient());
     }
-
-    wl_display *display = wl_client_get_display(shellClient());
-    m_pingSerial = wl_display_next_serial(display);
-    m_pingTimer.start();
-
-    desktop_shell_send_ping(m_child.desktop_shell, m_pingSerial);
-    wl_client_flush(shellClient());
 }
 
 void DesktopShell::pingTimerTimeout()
 {
     printf("The shell client is unresponsive, restarting it...\n");
-    m_pingTimer.stop();
-    wl_client_destroy(m_child.client);
+    wl_client_destroy(m_child->client);
 }
 
 void DesktopShell::sendInitEvents()
@@ -326,7 +380,7 @@ void DesktopShell::sendInitEvents()
     for (uint i = 0; i < numWorkspaces(); ++i) {
         Workspace *ws = workspace(i);
         DesktopShellWorkspace *dws = ws->findInterface<DesktopShellWorkspace>();
-        dws->init(m_child.client);
+        dws->init(m_child->client);
         workspaceAdded(dws);
     }
 
@@ -342,10 +396,10 @@ void DesktopShell::sendInitEvents()
     wl_list_for_each(out, &compositor()->output_list, link) {
         wl_resource *resource;
         wl_resource_for_each(resource, &out->resource_list) {
-            if (wl_resource_get_client(resource) == m_child.client) {
+            if (wl_resource_get_client(resource) == m_child->client) {
                 IRect2D rect = windowsArea(out);
                 m_outputs.push_back({ out, resource, rect });
-                desktop_shell_send_desktop_rect(m_child.desktop_shell, resource, rect.x, rect.y, rect.width, rect.height);
+                desktop_shell_send_desktop_rect(m_child->desktop_shell, resource, rect.x, rect.y, rect.width, rect.height);
                 break;
             }
         }
@@ -354,7 +408,7 @@ void DesktopShell::sendInitEvents()
 
 void DesktopShell::workspaceAdded(DesktopShellWorkspace *ws)
 {
-    desktop_shell_send_workspace_added(m_child.desktop_shell, ws->resource(), ws->workspace()->isActive());
+    desktop_shell_send_workspace_added(m_child->desktop_shell, ws->resource(), ws->workspace()->isActive());
 }
 
 void DesktopShell::surfaceResponsivenessChanged(ShellSurface *shsurf, bool responsiveness)
@@ -371,13 +425,26 @@ void DesktopShell::bind(struct wl_client *client, uint32_t version, uint32_t id)
 {
     struct wl_resource *resource = wl_resource_create(client, &desktop_shell_interface, version, id);
 
-    if (client == m_child.client) {
-        wl_resource_set_implementation(resource, &m_desktop_shell_implementation, this,
-                                       [](struct wl_resource *resource) { static_cast<DesktopShell *>(wl_resource_get_user_data(resource))->unbind(resource); });
-        m_child.desktop_shell = resource;
+    if (client == m_child->client) {
+        wl_resource_set_implementation(resource, &m_desktop_shell_implementation, this, resourceDestroyed);
+        m_child->desktop_shell = resource;
+        delete m_clientPinger;
+        m_clientPinger = new ClientPinger(this, resource);
+        StartupTimeline::mark("shell_client_bind");
 
         sendInitEvents();
         desktop_shell_send_load(resource);
+        // The previous client died while locked.
+        if (isLocked() && !hasLockSurface()) {
+            prepareLockSurface();
+        }
+        return;
+    }
+    if (m_standby && client == m_standby->client) {
+        // The standby client gets the state only when it is promoted, so that
+        // it stays idle until then, and it cannot change anything either.
+        wl_resource_set_implementation(resource, &s_standbyImplementation, this, resourceDestroyed);
+        m_standby->desktop_shell = resource;
         return;
     }
 
@@ -398,9 +465,38 @@ void DesktopShell::bindSplash(wl_client *client, uint32_t version, uint32_t id)
     wl_resource_destroy(resource);
 }
 
+void DesktopShell::resourceDestroyed(wl_resource *resource)
+{
+    static_cast<DesktopShell *>(wl_resource_get_user_data(resource))->unbind(resource);
+}
+
 void DesktopShell::unbind(struct wl_resource *resource)
 {
-    m_child.desktop_shell = nullptr;
+    if (m_standby && resource == m_standby->desktop_shell) {
+        m_standby->desktop_shell = nullptr;
+        return;
+    }
+    if (resource != m_child->desktop_shell) {
+        return;
+    }
+
+    m_child->desktop_shell = nullptr;
+    delete m_clientPinger;
+    m_clientPinger = nullptr;
+    shellClientUnbound();
+}
+
+void DesktopShell::standbyPromoted()
+{
+    wl_resource_set_implementation(m_child->desktop_shell, &m_desktop_shell_implementation, this, resourceDestroyed);
+    delete m_clientPinger;
+    m_clientPinger = new ClientPinger(this, m_child->desktop_shell);
+
+    sendInitEvents();
+    desktop_shell_send_load(m_child->desktop_shell);
+    if (isLocked() && !hasLockSurface()) {
+        prepareLockSurface();
+    }
 }
 
 void DesktopShell::moveBinding(struct weston_seat *seat, uint32_t time, uint32_t button)
@@ -483,6 +579,7 @@ void DesktopShell::closeBinding(weston_seat *seat, uint32_t time, uint32_t butto
 void DesktopShell::setBackground(struct wl_client *client, struct wl_resource *resource, struct wl_resource *output_resource,
                                  struct wl_resource *surface_resource)
 {
+    StartupTimeline::mark("set_background");
     struct weston_surface *surface = static_cast<weston_surface *>(wl_resource_get_user_data(surface_resource));
 
     setBackgroundSurface(surface, static_cast<weston_output *>(wl_resource_get_user_data(output_resource)));
@@ -611,6 +708,7 @@ struct desktop_shell_panel_interface Panel::s_implementation = {
 
 void DesktopShell::setPanel(wl_client *client, wl_resource *resource, uint32_t id, wl_resource *output_resource, wl_resource *surface_resource, uint32_t pos)
 {
+    StartupTimeline::mark("set_panel");
     weston_surface *surface = static_cast<weston_surface *>(wl_resource_get_user_data(surface_resource));
     weston_output *output = static_cast<weston_output *>(wl_resource_get_user_data(output_resource));
 
@@ -639,29 +737,24 @@ void DesktopShell::panelConfigure(weston_surface *es, int32_t sx, int32_t sy, Sh
     for (Output &out: m_outputs) {
         if (out.output == es->output && out.rect != rect) {
             out.rect = rect;
-            desktop_shell_send_desktop_rect(m_child.desktop_shell, out.resource, rect.x, rect.y, rect.width, rect.height);
+            desktop_shell_send_desktop_rect(m_child->desktop_shell, out.resource, rect.x, rect.y, rect.width, rect.height);
         }
     }
 }
 
 void DesktopShell::setLockSurface(struct wl_client *client, struct wl_resource *resource, struct wl_resource *surface_resource)
 {
-//     struct desktop_shell *shell = resource->data;
-//     struct weston_surface *surface = surface_resource->data;
-//
-//     shell->prepare_event_sent = false;
-//
-//     if (!shell->locked)
-//         return;
-//
-//     shell->lock_surface = surface;
-//
-//     shell->lock_surface_listener.notify = handle_lock_surface_destroy;
-//     wl_signal_add(&surface_resource->destroy_signal,
-//                   &shell->lock_surface_listener);
-//
-//     surface->configure = lock_surface_configure;
-//     surface->configure_private = shell;
+    weston_surface *surface = static_cast<weston_surface *>(wl_resource_get_user_data(surface_resource));
+    if (!Shell::setLockSurface(surface)) {
+        wl_resource_post_error(surface_resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "surface role already assigned");
+    }
+}
+
+void DesktopShell::prepareLockSurface()
+{
+    if (m_child->desktop_shell) {
+        desktop_shell_send_prepare_lock_surface(m_child->desktop_shell);
+    }
 }
 
 class PopupGrab : public ShellGrab {
@@ -791,12 +884,7 @@ void DesktopShell::setPopup(wl_client *client, wl_resource *resource, uint32_t i
 
 void DesktopShell::unlock(struct wl_client *client, struct wl_resource *resource)
 {
-//     struct desktop_shell *shell = resource->data;
-//
-//     shell->prepare_event_sent = false;
-//
-//     if (shell->locked)
-//         resume_desktop(shell);
+    Shell::unlock();
 }
 
 void DesktopShell::setGrabSurface(struct wl_client *client, struct wl_resource *resource, struct wl_resource *surface_resource)
@@ -806,10 +894,20 @@ void DesktopShell::setGrabSurface(struct wl_client *client, struct wl_resource *
 
 void DesktopShell::desktopReady(struct wl_client *client, struct wl_resource *resource)
 {
+    StartupTimeline::mark("desktop_ready");
+    m_splash->fadeOut();
+    if (m_splashSnapshot) {
+        m_splashSnapshot->fadeOut();
+    }
     if (m_sessionManager) {
-        m_sessionManager->restore();
+        StartupTimeline::begin("session_restore");
+        m_sessionManager->restore([]() {
+            StartupTimeline::end("session_restore");
+            StartupTimeline::finish();
+        });
+    } else {
+        StartupTimeline::finish();
     }
-    m_splash->fadeOut();
 }
 
 void DesktopShell::addKeyBinding(struct wl_client *client, struct wl_resource *resource, uint32_t id, uint32_t key, uint32_t modifiers)
@@ -819,8 +917,9 @@ void DesktopShell::addKeyBinding(struct wl_client *client, struct wl_resource *r
 
     weston_compositor_add_key_binding(compositor(), key, (weston_keyboard_modifier)modifiers,
                                          [](struct weston_seat *seat, uint32_t time, uint32_t key, void *data) {
-
-                                             desktop_shell_binding_send_triggered(static_cast<wl_resource *>(data));
+                                             if (!Shell::instance()->isLocked()) {
+                                                 desktop_shell_binding_send_triggered(static_cast<wl_resource *>(data));
+                                             }
                                          }, res);
 }
 
@@ -941,7 +1040,18 @@ void DesktopShell::createGrab(wl_client *client, wl_resource *resource, uint32_t
 
 void DesktopShell::quit(wl_client *client, wl_resource *resource)
 {
-    Shell::quit();
+    quitWithSnapshot();
+}
+
+void DesktopShell::quitWithSnapshot()
+{
+    if (!m_splashSnapshot) {
+        Shell::quit();
+        return;
+    }
+    // Wait for the outputs to be repainted once more, to be sure that what
+    // is read back is what the user is looking at.
+    m_splashSnapshot->capture([this]() { Shell::quit(); });
 }
 
 void DesktopShell::addTrustedClient(wl_client *client, wl_resource *resource, int32_t fd, const char *interface)
@@ -958,12 +1068,8 @@ void DesktopShell::addTrustedClient(wl_client *client, wl_resource *resource, in
 
 void DesktopShell::pong(uint32_t serial)
 {
-    if (!m_pingTimer.isRunning())
-        /* Just ignore unsolicited pong. */
-        return;
-
-    if (m_pingSerial == serial) {
-        m_pingTimer.stop();
+    if (m_clientPinger) {
+        m_clientPinger->handlePong(serial);
     }
 }
 
@@ -1009,6 +1115,37 @@ void DesktopShell::setSplashSurface(wl_client *client, wl_resource *resource, wl
     m_splash->addOutput(view, resource);
 }
 
+static void standbyIgnore(wl_client *, wl_resource *)
+{
+}
+
+static void standbyCreate(wl_client *, wl_resource *resource)
+{
+    wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_METHOD, "the standby shell client cannot create objects");
+}
+
+// The requests which only change some state are ignored, the ones which
+// create objects are errors since the objects could not be used.
+const struct desktop_shell_interface DesktopShell::s_standbyImplementation = {
+    [](wl_client *c, wl_resource *r, wl_resource *, wl_resource *) { standbyIgnore(c, r); },
+    [](wl_client *c, wl_resource *r, uint32_t, wl_resource *, wl_resource *, uint32_t) { standbyCreate(c, r); },
+    [](wl_client *c, wl_resource *r, wl_resource *) { standbyIgnore(c, r); },
+    [](wl_client *c, wl_resource *r, uint32_t, wl_resource *, wl_resource *, int32_t, int32_t) { standbyCreate(c, r); },
+    standbyIgnore,
+    [](wl_client *c, wl_resource *r, wl_resource *) { standbyIgnore(c, r); },
+    standbyIgnore,
+    [](wl_client *c, wl_resource *r, uint32_t, uint32_t, uint32_t) { standbyCreate(c, r); },
+    [](wl_client *c, wl_resource *r, wl_resource *, wl_resource *) { standbyIgnore(c, r); },
+    standbyIgnore,
+    standbyIgnore,
+    [](wl_client *c, wl_resource *r, uint32_t) { standbyCreate(c, r); },
+    standbyIgnore,
+    [](wl_client *c, wl_resource *r, wl_resource *) { standbyIgnore(c, r); },
+    standbyIgnore,
+    [](wl_client *, wl_resource *, int32_t fd, const char *) { close(fd); },
+    [](wl_client *c, wl_resource *r, uint32_t) { standbyIgnore(c, r); }
+};
+
 const struct desktop_shell_splash_interface DesktopShell::s_desktop_shell_splash_implementation = {
     wrapInterface(&DesktopShell::setSplashSurface)
 };
@@ -1017,9 +1154,11 @@ const struct desktop_shell_splash_interface DesktopShell::s_desktop_shell_splash
 WL_EXPORT int
 module_init(struct weston_compositor *ec, int *argc, char *argv[])
 {
+    StartupTimeline::mark("module_init");
 
     char *client = nullptr;
     char *sfile = nullptr;
+    bool standby = false;
 
     for (int i = *argc - 1; i >= 0; --i) {
         if (char *s = strstr(argv[i], "--nuclear-client=")) {
@@ -1028,6 +1167,9 @@ module_init(struct weston_compositor *ec, int *argc, char *argv[])
         } else if (char *s = strstr(argv[i], "--session-file=")) {
             sfile = strdup(s + 15);
             --*argc;
+        } else if (strcmp(argv[i], "--nuclear-standby-client") == 0) {
+            standby = true;
+            --*argc;
         }
     }
 
@@ -1037,8 +1179,17 @@ module_init(struct weston_compositor *ec, int *argc, char *argv[])
     }
     if (sfile) {
         shell->m_sessionManager = new SessionManager(sfile);
+        shell->m_splashSnapshot = new SplashSnapshot(shell, sfile);
     }
+    shell->setStandbyClientEnabled(standby);
+    StartupTimeline::begin("shell_init");
     shell->init();
+    StartupTimeline::end("shell_init");
+    // Apply the stored settings now, so that everything is configured before
+    // the first frame is drawn.
+    StartupTimeline::begin("settings_restore");
+    SettingsManager::restore();
+    StartupTimeline::end("settings_restore");
 
     return 0;
 }
@@ -32,6 +32,7 @@ class Splash;
 class Client;
 class Binding;
 class SessionManager;
+class SplashSnapshot;
 
 class DesktopShell : public Shell {
 public:
@@ -45,6 +46,8 @@ protected:
     virtual void setGrabCursor(Cursor cursor);
     virtual void panelConfigure(weston_surface *es, int32_t sx, int32_t sy, Shell::PanelPosition pos) override;
     virtual ShellSurface *createShellSurface(weston_surface *surface, const weston_shell_client *client) override;
+    virtual void standbyPromoted() override;
+    virtual void prepareLockSurface() override;
 
 private:
     void sendInitEvents();
@@ -53,6 +56,7 @@ private:
     void bind(struct wl_client *client, uint32_t version, uint32_t id);
     void bindSplash(wl_client *client, uint32_t version, uint32_t id);
     void unbind(struct wl_resource *resource);
+    static void resourceDestroyed(wl_resource *resource);
     void moveBinding(struct weston_seat *seat, uint32_t time, uint32_t button);
     void resizeBinding(struct weston_seat *seat, uint32_t time, uint32_t button);
     void closeBinding(struct weston_seat *seat, uint32_t time, uint32_t button);
@@ -61,6 +65,7 @@ private:
     void trustedClientDestroyed(void *client);
     void pointerMotion(ShellSeat *seat, weston_pointer *pointer);
     void pingTimerTimeout();
+    void quitWithSnapshot();
 
     void setBackground(struct wl_client *client, struct wl_resource *resource, struct wl_resource *output_resource,
                                              struct wl_resource *surface_resource);
@@ -83,6 +88,8 @@ private:
     static void configurePopup(weston_surface *es, int32_t sx, int32_t sy);
 
     static const struct desktop_shell_interface m_desktop_shell_implementation;
+    // For the standby client, until it is promoted.
+    static const struct desktop_shell_interface s_standbyImplementation;
     static const struct desktop_shell_splash_interface s_desktop_shell_splash_implementation;
 
     struct Output {
@@ -101,8 +108,9 @@ private:
     Binding *m_nextWsBinding;
     Binding *m_quitBinding;
     SessionManager *m_sessionManager;
-    Timer m_pingTimer;
-    uint32_t m_pingSerial;
+    SplashSnapshot *m_splashSnapshot;
+    class ClientPinger;
+    ClientPinger *m_clientPinger;
 
     friend class DesktopShellSettings;
     friend int module_init(weston_compositor *ec, int *argc, char *argv[]);
@@ -18,6 +18,7 @@
 #include "desktopshellwindow.h"
 #include "shell.h"
 #include "shellsurface.h"
+#include "windowregistry.h"
 
 #include "wayland-desktop-shell-server-protocol.h"
 
@@ -38,6 +39,8 @@ void DesktopShellWindow::added()
     shsurf()->typeChangedSignal.connect(this, &DesktopShellWindow::surfaceTypeChanged);
     shsurf()->titleChangedSignal.connect(this, &DesktopShellWindow::sendTitle);
     shsurf()->activeChangedSignal.connect(this, &DesktopShellWindow::activeChanged);
+    shsurf()->minimizedSignal.connect(this, &DesktopShellWindow::minimizedChanged);
+    shsurf()->unminimizedSignal.connect(this, &DesktopShellWindow::minimizedChanged);
     shsurf()->mappedSignal.connect(this, &DesktopShellWindow::mapped);
     shsurf()->unmappedSignal.connect(this, &DesktopShellWindow::destroy);
 }
@@ -81,6 +84,18 @@ void DesktopShellWindow::activeChanged()
     sendState();
 }
 
+void DesktopShellWindow::minimizedChanged(ShellSurface *)
+{
+    // The window may be minimized by the compositor itself, e.g. by a key action,
+    // so keep the state the client sees in sync.
+    if (shsurf()->isMinimized()) {
+        m_state |= DESKTOP_SHELL_WINDOW_STATE_MINIMIZED;
+    } else {
+        m_state &= ~DESKTOP_SHELL_WINDOW_STATE_MINIMIZED;
+    }
+    sendState();
+}
+
 void DesktopShellWindow::create()
 {
     m_resource = wl_resource_create(Shell::instance()->shellClient(), &desktop_shell_window_interface, 1, 0);
@@ -97,16 +112,24 @@ void DesktopShellWindow::destroy()
     }
 }
 
+// A shell client which reads the window registry gets the changes from
+// there, the events are only kept for the clients which do not.
+bool DesktopShellWindow::usesRegistry() const
+{
+    WindowRegistry *registry = Shell::instance()->findInterface<WindowRegistry>();
+    return registry && registry->isBound(Shell::instance()->shellClient());
+}
+
 void DesktopShellWindow::sendState()
 {
-    if (m_resource) {
+    if (m_resource && !usesRegistry()) {
         desktop_shell_window_send_state_changed(m_resource, m_state);
     }
 }
 
 void DesktopShellWindow::sendTitle()
 {
-    if (m_resource) {
+    if (m_resource && !usesRegistry()) {
         desktop_shell_window_send_set_title(m_resource, shsurf()->title().c_str());
     }
 }
@@ -39,10 +39,12 @@ private:
     ShellSurface *shsurf();
     void surfaceTypeChanged();
     void activeChanged();
+    void minimizedChanged(ShellSurface *);
     void mapped();
     void destroy();
     void sendState();
     void sendTitle();
+    bool usesRegistry() const;
     void setState(wl_client *client, wl_resource *resource, int32_t state);
     void close(wl_client *client, wl_resource *resource);
 
@@ -15,6 +15,8 @@
  * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include <linux/input.h>
 
 #include <weston/compositor.h>
@@ -23,7 +25,7 @@
 #include "utils.h"
 #include "shell.h"
 #include "binding.h"
-#include "animation.h"
+#include "springanimation.h"
 #include "wayland-dropdown-server-protocol.h"
 
 class Instance
@@ -43,6 +45,7 @@ public:
 
         m_toggleBinding.keyTriggered.connect(this, &Instance::toggle);
         m_toggleBinding.bindKey(KEY_F11, (weston_keyboard_modifier)0);
+        m_animation.setValue(m_animValue);
         m_animation.updateSignal->connect(this, &Instance::updateAnim);
 
         m_surfaceListener.signal->connect(this, &Instance::surfaceDestroyed);
@@ -92,9 +95,14 @@ public:
             weston_surface_activate(m_view->surface, seat);
         }
 
-        m_animation.setStart(m_animValue);
+        // Stop as soon as it is within half a pixel, moving less than half
+        // a pixel per frame at 60 Hz.
+        const IRect2D &available = Shell::instance()->windowsArea(m_output);
+        float range = std::max(m_view->surface->height + available.y - m_output->y, 1);
+        m_animation.setRestThreshold(0.5f / range, 30.f / range);
+        // Toggling again while it moves turns it around smoothly.
         m_animation.setTarget(!m_visible);
-        m_animation.run(m_output, 200);
+        m_animation.run(m_output);
     }
 
     void updateAnim(float value)
@@ -117,7 +125,7 @@ public:
     bool m_visible;
     weston_output *m_output;
     weston_view *m_view;
-    Animation m_animation;
+    SpringAnimation m_animation;
     float m_animValue;
     WlListener m_surfaceListener;
     static const struct nuclear_dropdown_interface s_implementation;
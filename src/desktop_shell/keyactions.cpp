@@ -0,0 +1,235 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <weston/compositor.h>
+
+#include "keyactions.h"
+#include "shell.h"
+#include "shellsurface.h"
+#include "binding.h"
+#include "settings.h"
+
+KeyActions::KeyActions()
+          : Interface()
+{
+    for (int i = 1; i <= NumWorkspaces; ++i) {
+        addEntry("workspace_" + std::to_string(i), Action::SelectWorkspace, i);
+    }
+    addEntry("minimize_focused", Action::MinimizeFocused, 0);
+    addEntry("close_focused", Action::CloseFocused, 0);
+    for (int i = 1; i <= NumLaunchers; ++i) {
+        addEntry("launch_" + std::to_string(i), Action::Launch, i);
+    }
+    for (int i = 1; i <= NumEffects; ++i) {
+        addEntry("toggle_effect_" + std::to_string(i), Action::ToggleEffect, i);
+    }
+}
+
+KeyActions::~KeyActions()
+{
+    for (auto &e: m_entries) {
+        delete e.second->binding;
+        delete e.second;
+    }
+}
+
+KeyActions::Entry *KeyActions::entry(const std::string &name)
+{
+    auto it = m_entries.find(name);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void KeyActions::addEntry(const std::string &name, Action action, int index)
+{
+    Entry *e = new Entry;
+    e->action = action;
+    e->index = index;
+    e->binding = new Binding;
+    e->binding->keyTriggered.connect([this, e](weston_seat *seat, uint32_t time, uint32_t key) {
+        run(e, seat);
+    });
+    m_entries[name] = e;
+}
+
+static ShellSurface *focusedSurface(weston_seat *seat)
+{
+    if (!seat->keyboard || !seat->keyboard->focus) {
+        return nullptr;
+    }
+
+    weston_surface *surface = weston_surface_get_main_surface(seat->keyboard->focus);
+    return Shell::getShellSurface(surface);
+}
+
+static void launch(const std::string &command)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+
+        sigset_t allsigs;
+        // do not give the signal mask set by weston to the new process
+        sigfillset(&allsigs);
+        sigprocmask(SIG_UNBLOCK, &allsigs, NULL);
+
+        pid_t p2 = fork();
+        if (p2 == 0) {
+            execl("/bin/sh", "/bin/sh", "-c", command.c_str(), (char *)nullptr);
+            _exit(0);
+        }
+        _exit(1);
+    } else if (pid < 0) {
+        weston_log("nuclear: failed to launch '%s'.\n", command.c_str());
+    }
+}
+
+static void toggleEffect(const std::string &path)
+{
+    auto it = SettingsManager::settings().find(path);
+    if (it == SettingsManager::settings().end()) {
+        weston_log("nuclear: cannot toggle unknown effect '%s'.\n", path.c_str());
+        return;
+    }
+
+    const Option *o = it->second->option("enabled");
+    if (!o || o->type() != Option::Type::Int) {
+        weston_log("nuclear: '%s' has no integer option 'enabled' to toggle.\n", path.c_str());
+        return;
+    }
+    bool enabled = o->isSet() && o->valueAsInt();
+    SettingsManager::set(path.c_str(), "enabled", !enabled);
+}
+
+void KeyActions::run(Entry *e, weston_seat *seat)
+{
+    Shell *shell = Shell::instance();
+
+    switch (e->action) {
+        case Action::SelectWorkspace:
+            if (e->index <= (int)shell->numWorkspaces()) {
+                shell->selectWorkspace(e->index - 1);
+            }
+            break;
+        case Action::MinimizeFocused:
+            if (ShellSurface *s = focusedSurface(seat)) {
+                s->setMinimized(true);
+                if (s->isActive()) {
+                    s->deactivate();
+                }
+            }
+            break;
+        case Action::CloseFocused:
+            if (ShellSurface *s = focusedSurface(seat)) {
+                s->close();
+            }
+            break;
+        case Action::Launch:
+            if (!e->argument.empty()) {
+                launch(e->argument);
+            }
+            break;
+        case Action::ToggleEffect:
+            if (!e->argument.empty()) {
+                toggleEffect(e->argument);
+            }
+            break;
+    }
+}
+
+
+class KeyActionsSettings : public Settings
+{
+public:
+    inline KeyActions *actions() const
+    {
+        return Shell::instance()->findInterface<KeyActions>();
+    }
+
+    virtual std::list<Option> options() const override
+    {
+        std::list<Option> list;
+        for (int i = 1; i <= KeyActions::NumWorkspaces; ++i) {
+            list.push_back(Option::binding(name("workspace_", i, "").c_str(), Binding::Type::Key));
+        }
+        list.push_back(Option::binding("minimize_focused", Binding::Type::Key));
+        list.push_back(Option::binding("close_focused", Binding::Type::Key));
+        for (int i = 1; i <= KeyActions::NumLaunchers; ++i) {
+            list.push_back(Option::binding(name("launch_", i, "").c_str(), Binding::Type::Key));
+            list.push_back(Option::string(name("launch_", i, "_command").c_str()));
+        }
+        for (int i = 1; i <= KeyActions::NumEffects; ++i) {
+            list.push_back(Option::binding(name("toggle_effect_", i, "").c_str(), Binding::Type::Key));
+            list.push_back(Option::string(name("toggle_effect_", i, "_path").c_str()));
+        }
+        return list;
+    }
+
+    virtual void unSet(const std::string &name) override
+    {
+        if (KeyActions::Entry *e = entry(name)) {
+            e->binding->reset();
+        } else if (KeyActions::Entry *a = argumentEntry(name)) {
+            a->argument.clear();
+        }
+    }
+
+    virtual void set(const std::string &name, const std::string &v) override
+    {
+        if (KeyActions::Entry *e = argumentEntry(name)) {
+            e->argument = v;
+        }
+    }
+
+    virtual void set(const std::string &name, const Option::BindingValue &v) override
+    {
+        if (KeyActions::Entry *e = entry(name)) {
+            v.bind(e->binding);
+        }
+    }
+
+private:
+    static std::string name(const char *prefix, int i, const char *suffix)
+    {
+        return prefix + std::to_string(i) + suffix;
+    }
+
+    KeyActions::Entry *entry(const std::string &name) const
+    {
+        KeyActions *a = actions();
+        return a ? a->entry(name) : nullptr;
+    }
+
+    KeyActions::Entry *argumentEntry(const std::string &name) const
+    {
+        for (const char *suffix: { "_command", "_path" }) {
+            size_t len = strlen(suffix);
+            if (name.size() > len && name.compare(name.size() - len, len, suffix) == 0) {
+                return entry(name.substr(0, name.size() - len));
+            }
+        }
+        return nullptr;
+    }
+};
+
+SETTINGS(key_actions, KeyActionsSettings)
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEYACTIONS_H
+#define KEYACTIONS_H
+
+#include <string>
+#include <unordered_map>
+
+#include "interface.h"
+
+class Binding;
+struct weston_seat;
+
+/*
+ * A table of actions which are run directly by the compositor when their key
+ * is pressed, without asking the shell client what to do. The keys and the
+ * action arguments are configured with the "key_actions" settings.
+ */
+class KeyActions : public Interface
+{
+public:
+    enum class Action {
+        SelectWorkspace,
+        MinimizeFocused,
+        CloseFocused,
+        Launch,
+        ToggleEffect
+    };
+    struct Entry {
+        Action action;
+        int index;
+        std::string argument;
+        Binding *binding;
+    };
+
+    static const int NumWorkspaces = 9;
+    static const int NumLaunchers = 8;
+    static const int NumEffects = 4;
+
+    KeyActions();
+    ~KeyActions();
+
+    Entry *entry(const std::string &name);
+
+private:
+    void addEntry(const std::string &name, Action action, int index);
+    void run(Entry *e, weston_seat *seat);
+
+    std::unordered_map<std::string, Entry *> m_entries;
+};
+
+#endif
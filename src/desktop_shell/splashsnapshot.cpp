@@ -0,0 +1,333 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <vector>
+
+#include <weston/compositor.h>
+
+#include "splashsnapshot.h"
+#include "shell.h"
+#include "internalclient.h"
+#include "screenshooter.h"
+#include "animation.h"
+#include "transform.h"
+
+static const uint32_t Magic = 0x4c50534e; // "NSPL"
+// The snapshot is only seen for a moment and fading out, a quarter of the
+// resolution is plenty and makes it quick to load.
+static const int32_t Scale = 4;
+
+struct Header {
+    uint32_t magic;
+    uint32_t width;
+    uint32_t height;
+    uint32_t modeWidth;
+    uint32_t modeHeight;
+};
+
+struct SplashSnapshot::View {
+    weston_view *view;
+    wl_resource *buffer;
+    Transform transform;
+    Animation animation;
+    bool faded;
+};
+
+struct SplashSnapshot::Capture {
+    weston_output *output;
+    WlListener frameListener;
+    bool done;
+};
+
+SplashSnapshot::SplashSnapshot(Shell *shell, const std::string &basePath)
+              : m_shell(shell)
+              , m_basePath(basePath)
+              , m_captureTimeout(500)
+              , m_fadeIdle(nullptr)
+              , m_captureIdle(nullptr)
+{
+    m_captureTimeout.triggered.connect([this]() {
+        m_captureTimeout.stop();
+        finishCapture();
+    });
+}
+
+SplashSnapshot::~SplashSnapshot()
+{
+    if (m_fadeIdle) {
+        wl_event_source_remove(m_fadeIdle);
+    }
+    if (m_captureIdle) {
+        wl_event_source_remove(m_captureIdle);
+    }
+    for (View *v: m_views) {
+        destroyView(v);
+    }
+    for (Capture *c: m_captures) {
+        delete c;
+    }
+}
+
+std::string SplashSnapshot::fileName(weston_output *output) const
+{
+    return m_basePath + ".splash-" + output->name;
+}
+
+void SplashSnapshot::show()
+{
+    InternalClient *client = m_shell->internalClient();
+
+    weston_output *output;
+    wl_list_for_each(output, &Shell::compositor()->output_list, link) {
+        FILE *f = fopen(fileName(output).c_str(), "rb");
+        if (!f) {
+            continue;
+        }
+
+        Header header;
+        if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != Magic ||
+            header.modeWidth != (uint32_t)output->current_mode->width ||
+            header.modeHeight != (uint32_t)output->current_mode->height ||
+            header.width != header.modeWidth / Scale || header.height != header.modeHeight / Scale ||
+            header.width == 0 || header.height == 0) {
+            fclose(f);
+            continue;
+        }
+
+        void *data;
+        int32_t stride;
+        weston_buffer *buffer = client->createBuffer(header.width, header.height, &data, &stride);
+        bool ok = buffer;
+        for (uint32_t y = 0; ok && y < header.height; ++y) {
+            ok = fread(static_cast<char *>(data) + y * stride, 4, header.width, f) == header.width;
+        }
+        fclose(f);
+        if (!ok) {
+            if (buffer) {
+                wl_resource_destroy(buffer->resource);
+            }
+            continue;
+        }
+
+        weston_surface *surface = client->createSurface(buffer, header.width, header.height);
+        weston_view *view = surface ? weston_view_create(surface) : nullptr;
+        if (!view) {
+            if (surface) {
+                weston_surface_destroy(surface);
+            }
+            wl_resource_destroy(buffer->resource);
+            continue;
+        }
+
+        View *v = new View;
+        v->buffer = buffer->resource;
+        v->view = view;
+        v->faded = false;
+        v->transform.scale((float)output->width / header.width, (float)output->height / header.height, 1.f);
+        wl_list_insert(&v->view->geometry.transformation_list, &v->transform.nativeHandle()->link);
+        weston_view_set_position(v->view, output->x, output->y);
+        v->view->output = output;
+        v->view->surface->output = output;
+        m_shell->setSplash(v->view);
+        m_views.push_back(v);
+    }
+}
+
+void SplashSnapshot::fadeOut()
+{
+    for (View *v: m_views) {
+        if (v->animation.isRunning()) {
+            continue;
+        }
+        weston_view *view = v->view;
+        v->animation.updateSignal->connect([view](float a) {
+            view->alpha = a;
+            weston_view_geometry_dirty(view);
+            weston_surface_damage(view->surface);
+        });
+        v->animation.doneSignal->connect([this, v]() {
+            // The animation cannot be destroyed while it is emitting.
+            v->faded = true;
+            if (!m_fadeIdle) {
+                wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+                m_fadeIdle = wl_event_loop_add_idle(loop, [](void *data) {
+                    static_cast<SplashSnapshot *>(data)->destroyFadedViews();
+                }, this);
+            }
+        });
+        v->animation.setStart(1.f);
+        v->animation.setTarget(0.f);
+        v->animation.run(v->view->output, 250, Animation::Flags::Alpha);
+    }
+}
+
+void SplashSnapshot::destroyFadedViews()
+{
+    m_fadeIdle = nullptr;
+    for (auto i = m_views.begin(); i != m_views.end();) {
+        View *v = *i;
+        if (v->faded) {
+            destroyView(v);
+            i = m_views.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void SplashSnapshot::destroyView(View *v)
+{
+    wl_list_remove(&v->transform.nativeHandle()->link);
+    weston_surface_destroy(v->view->surface);
+    wl_resource_destroy(v->buffer);
+    delete v;
+}
+
+void SplashSnapshot::capture(const std::function<void ()> &done)
+{
+    if (m_captureDone) {
+        // Already waiting for the repaint.
+        return;
+    }
+    m_captureDone = done;
+
+    weston_output *output;
+    wl_list_for_each(output, &Shell::compositor()->output_list, link) {
+        // The pixels are read from the framebuffer, which is rotated.
+        if (output->transform != WL_OUTPUT_TRANSFORM_NORMAL) {
+            continue;
+        }
+
+        Capture *c = new Capture;
+        c->output = output;
+        c->done = false;
+        c->frameListener.listen(&output->frame_signal);
+        c->frameListener.signal->connect([this, c](void *) { captureDone(c); });
+        m_captures.push_back(c);
+        weston_output_damage(output);
+    }
+
+    if (m_captures.empty()) {
+        finishCapture();
+    } else {
+        m_captureTimeout.start();
+    }
+}
+
+void SplashSnapshot::captureDone(Capture *c)
+{
+    c->frameListener.reset();
+    c->done = true;
+    save(c);
+
+    for (Capture *other: m_captures) {
+        if (!other->done) {
+            return;
+        }
+    }
+    // Called by the frame signal of the capture, delete it later.
+    if (!m_captureIdle) {
+        wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+        m_captureIdle = wl_event_loop_add_idle(loop, [](void *data) {
+            // The loop removes the source after calling it.
+            SplashSnapshot *self = static_cast<SplashSnapshot *>(data);
+            self->m_captureIdle = nullptr;
+            self->finishCapture();
+        }, this);
+    }
+}
+
+void SplashSnapshot::finishCapture()
+{
+    if (m_captureIdle) {
+        // Called by the timeout before the idle ran.
+        wl_event_source_remove(m_captureIdle);
+        m_captureIdle = nullptr;
+    }
+    m_captureTimeout.stop();
+    for (Capture *c: m_captures) {
+        delete c;
+    }
+    m_captures.clear();
+
+    if (m_captureDone) {
+        std::function<void ()> done = m_captureDone;
+        m_captureDone = nullptr;
+        done();
+    }
+}
+
+void SplashSnapshot::save(Capture *c)
+{
+    weston_output *output = c->output;
+    int32_t modeWidth = output->current_mode->width;
+    int32_t modeHeight = output->current_mode->height;
+    int32_t width = modeWidth / Scale;
+    int32_t height = modeHeight / Scale;
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    std::vector<uint32_t> pixels(modeWidth * modeHeight);
+    if (!Screenshooter::readPixels(output, IRect2D(0, 0, modeWidth, modeHeight), pixels.data(), modeWidth * 4)) {
+        return;
+    }
+
+    // Average every Scale x Scale block, in place at the start of the vector.
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            uint32_t r = 0, g = 0, b = 0;
+            for (int32_t j = 0; j < Scale; ++j) {
+                const uint32_t *src = &pixels[(y * Scale + j) * modeWidth + x * Scale];
+                for (int32_t i = 0; i < Scale; ++i) {
+                    r += (src[i] >> 16) & 0xff;
+                    g += (src[i] >> 8) & 0xff;
+                    b += src[i] & 0xff;
+                }
+            }
+            const uint32_t n = Scale * Scale;
+            pixels[y * width + x] = 0xff000000 | (r / n) << 16 | (g / n) << 8 | (b / n);
+        }
+    }
+
+    Header header = { Magic, (uint32_t)width, (uint32_t)height, (uint32_t)modeWidth, (uint32_t)modeHeight };
+    std::string path = fileName(output);
+    std::string tmp = path + ".tmp";
+    // It is a picture of the screen, only the user may read it.
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+    FILE *f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        unlink(tmp.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(pixels.data(), 4, width * height, f) == (size_t)(width * height);
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) < 0) {
+        weston_log("nuclear: cannot save the splash snapshot to '%s'.\n", path.c_str());
+        unlink(tmp.c_str());
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPLASHSNAPSHOT_H
+#define SPLASHSNAPSHOT_H
+
+#include <string>
+#include <list>
+#include <functional>
+
+#include "utils.h"
+
+class Shell;
+class Animation;
+struct weston_output;
+struct weston_surface;
+struct weston_view;
+struct wl_event_source;
+
+/*
+ * Saves a downscaled picture of every output when the shell quits, and
+ * shows it on the next startup from the first frame until the desktop is
+ * ready, so that the user does not look at a black screen while the shell
+ * client starts. The pictures are stored next to the session file, one
+ * per output name, and are not used if the output mode has changed.
+ */
+class SplashSnapshot
+{
+public:
+    SplashSnapshot(Shell *shell, const std::string &basePath);
+    ~SplashSnapshot();
+
+    void show();
+    void fadeOut();
+
+    /*
+     * Captures the outputs after their next repaint and calls 'done' when
+     * all the pictures are written, or after a timeout.
+     */
+    void capture(const std::function<void ()> &done);
+
+private:
+    struct View;
+    struct Capture;
+
+    std::string fileName(weston_output *output) const;
+    void save(Capture *c);
+    void captureDone(Capture *c);
+    void finishCapture();
+    void destroyFadedViews();
+    void destroyView(View *v);
+
+    Shell *m_shell;
+    std::string m_basePath;
+    std::list<View *> m_views;
+    std::list<Capture *> m_captures;
+    std::function<void ()> m_captureDone;
+    Timer m_captureTimeout;
+    wl_event_source *m_fadeIdle;
+    wl_event_source *m_captureIdle;
+};
+
+#endif
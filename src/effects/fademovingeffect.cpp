@@ -21,7 +21,7 @@
 
 const int ALPHA_ANIM_DURATION = 200;
 
-struct FadeMovingEffect::Surface {
+struct FadeMovingEffect::Surface : public Counted<FadeMovingEffect::Surface> {
     ShellSurface *surface;
     Animation animation;
 };
@@ -45,7 +45,7 @@ void FadeMovingEffect::start(ShellSurface *surface)
     Surface *surf = findSurface(surface);
     surf->animation.setStart(surface->alpha());
     surf->animation.setTarget(0.8);
-    surf->animation.run(surface->output(), ALPHA_ANIM_DURATION);
+    surf->animation.run(surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
 }
 
 void FadeMovingEffect::end(ShellSurface *surface)
@@ -53,7 +53,7 @@ void FadeMovingEffect::end(ShellSurface *surface)
     Surface *surf = findSurface(surface);
     surf->animation.setStart(surface->alpha());
     surf->animation.setTarget(1.0);
-    surf->animation.run(surface->output(), ALPHA_ANIM_DURATION);
+    surf->animation.run(surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
 }
 
 void FadeMovingEffect::addedSurface(ShellSurface *surface)
@@ -21,7 +21,7 @@
 
 const int ALPHA_ANIM_DURATION = 200;
 
-struct InOutSurfaceEffect::Surface {
+struct InOutSurfaceEffect::Surface : public Counted<InOutSurfaceEffect::Surface> {
     weston_view *view;
     Animation animation;
     InOutSurfaceEffect *effect;
@@ -47,7 +47,7 @@ struct InOutSurfaceEffect::Surface {
 
         surf->animation.setStart(surf->view->alpha);
         surf->animation.setTarget(0);
-        surf->animation.run(surf->view->output, ALPHA_ANIM_DURATION, Animation::Flags::SendDone);
+        surf->animation.run(surf->view->output, ALPHA_ANIM_DURATION, Animation::Flags::SendDone | Animation::Flags::Alpha);
     }
 };
 
@@ -83,7 +83,7 @@ void InOutSurfaceEffect::addedSurface(ShellSurface *surface)
 
     surf->animation.setStart(0);
     surf->animation.setTarget(1);
-    surf->animation.run(surface->output(), ALPHA_ANIM_DURATION);
+    surf->animation.run(surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
 }
 
 
@@ -21,7 +21,7 @@
 
 static const int ANIM_DURATION = 150;
 
-struct MinimizeEffect::Surface {
+struct MinimizeEffect::Surface : public Counted<MinimizeEffect::Surface> {
     ShellSurface *surface;
     Animation animation;
     weston_transform transform;
@@ -28,7 +28,7 @@
 const float INACTIVE_ALPHA = 0.8;
 const int ALPHA_ANIM_DURATION = 200;
 
-struct SurfaceTransform {
+struct SurfaceTransform : public Counted<SurfaceTransform> {
     void updateAnimation(float value);
     void doneAnimation();
 
@@ -71,7 +71,7 @@ struct Grab : public ShellGrab {
 
             tr->alphaAnim.setStart(curr);
             tr->alphaAnim.setTarget(alpha);
-            tr->alphaAnim.run(tr->surface->output(), ALPHA_ANIM_DURATION);
+            tr->alphaAnim.run(tr->surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
         }
     }
     void button(uint32_t time, uint32_t button, uint32_t state) override
@@ -161,7 +161,7 @@ void ScaleEffect::run(struct weston_seat *ws)
 
             surf->alphaAnim.setStart(surf->surface->alpha());
             surf->alphaAnim.setTarget(surf->minimize ? 0.f : 1.f);
-            surf->alphaAnim.run(surf->surface->output(), ALPHA_ANIM_DURATION);
+            surf->alphaAnim.run(surf->surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
         } else {
             surf->wasMinimized = surf->surface->isMinimized();
             if (surf->wasMinimized) {
@@ -200,7 +200,7 @@ void ScaleEffect::run(struct weston_seat *ws)
 
             surf->alphaAnim.setStart(surf->wasMinimized ? 0 : surf->surface->alpha());
             surf->alphaAnim.setTarget(INACTIVE_ALPHA);
-            surf->alphaAnim.run(surf->surface->output(), ALPHA_ANIM_DURATION);
+            surf->alphaAnim.run(surf->surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
 
             surf->surface->addTransform(&surf->transform);
         }
@@ -226,7 +226,7 @@ void ScaleEffect::run(struct weston_seat *ws)
                 if (tr->surface == s) {
                     tr->alphaAnim.setStart(tr->surface->alpha());
                     tr->alphaAnim.setTarget(1.0);
-                    tr->alphaAnim.run(tr->surface->output(), ALPHA_ANIM_DURATION);
+                    tr->alphaAnim.run(tr->surface->output(), ALPHA_ANIM_DURATION, Animation::Flags::Alpha);
                     break;
                 }
             }
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "gamemode.h"
+#include "shellsurface.h"
+#include "settings.h"
+
+GameMode *GameMode::instance()
+{
+    static GameMode *gameMode = new GameMode;
+    return gameMode;
+}
+
+GameMode::GameMode()
+        : m_enabled(false)
+        , m_onFullscreen(true)
+{
+}
+
+bool GameMode::qualifies(const ShellSurface *surface) const
+{
+    if (!m_enabled || !surface) {
+        return false;
+    }
+    if (m_onFullscreen && surface->isFullscreen()) {
+        return true;
+    }
+    return std::find(m_appIds.begin(), m_appIds.end(), surface->className()) != m_appIds.end();
+}
+
+void GameMode::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    policyChanged();
+}
+
+void GameMode::setOnFullscreen(bool onFullscreen)
+{
+    m_onFullscreen = onFullscreen;
+    policyChanged();
+}
+
+void GameMode::setAppIds(const std::string &ids)
+{
+    m_appIds.clear();
+    size_t start = 0;
+    while (start <= ids.size()) {
+        size_t end = ids.find(',', start);
+        if (end == std::string::npos) {
+            end = ids.size();
+        }
+        std::string id = ids.substr(start, end - start);
+        id.erase(0, id.find_first_not_of(' '));
+        id.erase(id.find_last_not_of(' ') + 1);
+        if (!id.empty()) {
+            m_appIds.push_back(id);
+        }
+        start = end + 1;
+    }
+    policyChanged();
+}
+
+
+class GameModeSettings : public Settings
+{
+public:
+    virtual std::list<Option> options() const override
+    {
+        std::list<Option> list;
+        list.push_back(Option::integer("enabled"));
+        list.push_back(Option::integer("on_fullscreen"));
+        list.push_back(Option::string("app_ids"));
+        return list;
+    }
+
+    virtual void unSet(const std::string &name) override
+    {
+        if (name == "enabled") {
+            GameMode::instance()->setEnabled(false);
+        } else if (name == "on_fullscreen") {
+            GameMode::instance()->setOnFullscreen(true);
+        } else if (name == "app_ids") {
+            GameMode::instance()->setAppIds(std::string());
+        }
+    }
+
+    virtual void set(const std::string &name, int v) override
+    {
+        if (name == "enabled") {
+            GameMode::instance()->setEnabled(v);
+        } else if (name == "on_fullscreen") {
+            GameMode::instance()->setOnFullscreen(v);
+        }
+    }
+
+    virtual void set(const std::string &name, const std::string &v) override
+    {
+        if (name == "app_ids") {
+            GameMode::instance()->setAppIds(v);
+        }
+    }
+};
+
+SETTINGS(game_mode, GameModeSettings)
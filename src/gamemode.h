@@ -0,0 +1,58 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GAMEMODE_H
+#define GAMEMODE_H
+
+#include <string>
+#include <list>
+
+#include "shellsignal.h"
+
+class ShellSurface;
+
+/*
+ * The policy deciding when the focused surface gets the game mode, in
+ * which the shell gets out of its way: no effects, no hot spots, no pings,
+ * and when it is fullscreen all the layers below it are taken out of the
+ * compositor. Configured by the "game_mode" settings: enabled,
+ * on_fullscreen, to trigger it for any fullscreen surface, and app_ids,
+ * a comma separated list of app ids which trigger it even when not
+ * fullscreen.
+ */
+class GameMode
+{
+public:
+    static GameMode *instance();
+
+    bool qualifies(const ShellSurface *surface) const;
+
+    void setEnabled(bool enabled);
+    void setOnFullscreen(bool onFullscreen);
+    void setAppIds(const std::string &ids);
+
+    Signal<> policyChanged;
+
+private:
+    GameMode();
+
+    bool m_enabled;
+    bool m_onFullscreen;
+    std::list<std::string> m_appIds;
+};
+
+#endif
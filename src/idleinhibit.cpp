@@ -0,0 +1,112 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <weston/compositor.h>
+
+#include "idleinhibit.h"
+#include "idlemanager.h"
+#include "shell.h"
+#include "utils.h"
+#include "objectstats.h"
+#include "wayland-idle-inhibit-server-protocol.h"
+
+class IdleInhibitor : public Counted<IdleInhibitor>
+{
+public:
+    IdleInhibitor(wl_client *client, wl_resource *parent, uint32_t id, weston_surface *surface);
+    ~IdleInhibitor();
+
+private:
+    void destroy(wl_client *client, wl_resource *resource);
+    void surfaceDestroyed(void *data);
+    void release();
+
+    wl_resource *m_resource;
+    WlListener m_surfaceDestroyListener;
+    bool m_active;
+
+    static const struct nuclear_idle_inhibitor_interface s_implementation;
+};
+
+IdleInhibitor::IdleInhibitor(wl_client *client, wl_resource *parent, uint32_t id, weston_surface *surface)
+             : m_active(true)
+{
+    m_resource = wl_resource_create(client, &nuclear_idle_inhibitor_interface, wl_resource_get_version(parent), id);
+    wl_resource_set_implementation(m_resource, &s_implementation, this, [](wl_resource *res) {
+        delete static_cast<IdleInhibitor *>(wl_resource_get_user_data(res));
+    });
+
+    m_surfaceDestroyListener.listen(&surface->destroy_signal);
+    m_surfaceDestroyListener.signal->connect(this, &IdleInhibitor::surfaceDestroyed);
+    IdleManager::instance()->addInhibitor();
+}
+
+IdleInhibitor::~IdleInhibitor()
+{
+    release();
+}
+
+void IdleInhibitor::release()
+{
+    if (m_active) {
+        m_active = false;
+        IdleManager::instance()->removeInhibitor();
+    }
+}
+
+void IdleInhibitor::destroy(wl_client *client, wl_resource *resource)
+{
+    wl_resource_destroy(resource);
+}
+
+void IdleInhibitor::surfaceDestroyed(void *data)
+{
+    m_surfaceDestroyListener.reset();
+    release();
+}
+
+const struct nuclear_idle_inhibitor_interface IdleInhibitor::s_implementation = {
+    wrapInterface(&IdleInhibitor::destroy)
+};
+
+
+
+IdleInhibit::IdleInhibit()
+{
+    wl_global_create(Shell::instance()->compositor()->wl_display, &nuclear_idle_inhibit_interface, 1, this,
+                     [](wl_client *client, void *data, uint32_t version, uint32_t id) {
+                         static_cast<IdleInhibit *>(data)->bind(client, version, id);
+                     });
+}
+
+void IdleInhibit::bind(wl_client *client, uint32_t version, uint32_t id)
+{
+    // Any client can bind this, the players are not trusted clients.
+    wl_resource *resource = wl_resource_create(client, &nuclear_idle_inhibit_interface, version, id);
+    wl_resource_set_implementation(resource, &s_implementation, this, nullptr);
+    ObjectStats::countResource(resource, &nuclear_idle_inhibit_interface);
+}
+
+void IdleInhibit::createInhibitor(wl_client *client, wl_resource *resource, uint32_t id, wl_resource *surface_resource)
+{
+    weston_surface *surface = static_cast<weston_surface *>(wl_resource_get_user_data(surface_resource));
+    new IdleInhibitor(client, resource, id, surface);
+}
+
+const struct nuclear_idle_inhibit_interface IdleInhibit::s_implementation = {
+    wrapInterface(&IdleInhibit::createInhibitor)
+};
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <weston/compositor.h>
+
+#include "idlemanager.h"
+#include "animation.h"
+#include "responsivenessmonitor.h"
+#include "settings.h"
+#include "shell.h"
+
+IdleManager *IdleManager::instance()
+{
+    static IdleManager *manager = new IdleManager;
+    return manager;
+}
+
+IdleManager::IdleManager()
+           : m_blankTimer(0)
+           , m_idle(false)
+           , m_defaultIdleTimeout(Shell::compositor()->idle_time)
+           , m_blankTimeout(0)
+{
+    weston_compositor *ec = Shell::compositor();
+    m_idleListener.listen(&ec->idle_signal);
+    m_idleListener.signal->connect(this, &IdleManager::idle);
+    m_wakeListener.listen(&ec->wake_signal);
+    m_wakeListener.signal->connect(this, &IdleManager::wake);
+    m_blankTimer.triggered.connect([this]() {
+        m_blankTimer.stop();
+        weston_compositor_sleep(Shell::compositor());
+    });
+}
+
+void IdleManager::idle(void *)
+{
+    if (m_idle) {
+        return;
+    }
+    m_idle = true;
+
+    weston_output *out;
+    wl_list_for_each(out, &Shell::compositor()->output_list, link) {
+        Animation::finishAll(out);
+    }
+    Animation::setInstant(true);
+    ResponsivenessMonitor::instance()->pause();
+    if (m_blankTimeout > 0) {
+        m_blankTimer.setInterval(m_blankTimeout * 1000);
+        m_blankTimer.start();
+    }
+    idleChanged(true);
+}
+
+void IdleManager::wake(void *)
+{
+    if (!m_idle) {
+        return;
+    }
+    m_idle = false;
+
+    m_blankTimer.stop();
+    Animation::setInstant(false);
+    ResponsivenessMonitor::instance()->resume();
+    idleChanged(false);
+}
+
+void IdleManager::addInhibitor()
+{
+    // The compositor does not go idle while inhibited, and wakes up now.
+    weston_compositor_idle_inhibit(Shell::compositor());
+}
+
+void IdleManager::removeInhibitor()
+{
+    // Restarts the idle timer.
+    weston_compositor_idle_release(Shell::compositor());
+}
+
+void IdleManager::setIdleTimeout(int timeout)
+{
+    weston_compositor *ec = Shell::compositor();
+    ec->idle_time = timeout;
+    if (!m_idle) {
+        // Restart the timer with the new timeout.
+        weston_compositor_wake(ec);
+    }
+}
+
+void IdleManager::resetIdleTimeout()
+{
+    setIdleTimeout(m_defaultIdleTimeout);
+}
+
+void IdleManager::setBlankTimeout(int timeout)
+{
+    m_blankTimeout = timeout;
+}
+
+
+class IdleSettings : public Settings
+{
+public:
+    virtual std::list<Option> options() const override
+    {
+        std::list<Option> list;
+        list.push_back(Option::integer("idle_timeout"));
+        list.push_back(Option::integer("blank_timeout"));
+        return list;
+    }
+
+    virtual void unSet(const std::string &name) override
+    {
+        if (name == "idle_timeout") {
+            IdleManager::instance()->resetIdleTimeout();
+        } else if (name == "blank_timeout") {
+            IdleManager::instance()->setBlankTimeout(0);
+        }
+    }
+
+    virtual void set(const std::string &name, int v) override
+    {
+        if (name == "idle_timeout") {
+            IdleManager::instance()->setIdleTimeout(v > 0 ? v : 0);
+        } else if (name == "blank_timeout") {
+            IdleManager::instance()->setBlankTimeout(v > 0 ? v : 0);
+        }
+    }
+};
+
+SETTINGS(idle, IdleSettings)
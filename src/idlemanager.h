@@ -0,0 +1,65 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDLEMANAGER_H
+#define IDLEMANAGER_H
+
+#include "utils.h"
+#include "shellsignal.h"
+
+/*
+ * Tracks whether the user is using the session. The compositor already
+ * restarts its idle timer on every input event, of any seat, so that is
+ * used as the source: when it expires the session goes idle, the
+ * animations become instant, the clients are not pinged anymore and
+ * after a while the screens are optionally blanked. The first input
+ * event brings everything back. Inhibitors are the compositor's own idle
+ * inhibit count, so the session does not go idle at all while they exist.
+ */
+class IdleManager
+{
+public:
+    static IdleManager *instance();
+
+    inline bool isIdle() const { return m_idle; }
+
+    void addInhibitor();
+    void removeInhibitor();
+
+    /*
+     * In seconds, 0 disables them.
+     */
+    void setIdleTimeout(int timeout);
+    void resetIdleTimeout();
+    void setBlankTimeout(int timeout);
+
+    Signal<bool> idleChanged;
+
+private:
+    IdleManager();
+    void idle(void *);
+    void wake(void *);
+
+    WlListener m_idleListener;
+    WlListener m_wakeListener;
+    Timer m_blankTimer;
+    bool m_idle;
+    int m_defaultIdleTimeout;
+    int m_blankTimeout;
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <memory>
+
+#include "imageencoder.h"
+#include "workerpool.h"
+
+bool ImageEncoder::isSupported(Format format)
+{
+    switch (format) {
+        case Format::Qoi:
+            return true;
+        case Format::Png:
+#ifdef HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+static bool writeAll(int fd, const std::vector<uint8_t> &data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t r = write(fd, data.data() + written, data.size() - written);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += r;
+    }
+    return true;
+}
+
+void ImageEncoder::encode(Format format, std::vector<uint32_t> &&pixels, int32_t width, int32_t height, int fd,
+                          const std::function<void (bool)> &done)
+{
+    // std::function needs copyable captures, share the pixels instead of copying them.
+    std::shared_ptr<std::vector<uint32_t>> data = std::make_shared<std::vector<uint32_t>>(std::move(pixels));
+    WorkerPool::instance()->run<bool>([format, data, width, height, fd]() {
+        std::vector<uint8_t> encoded;
+        bool ok = false;
+        switch (format) {
+            case Format::Qoi:
+                ok = encodeQoi(data->data(), width, height, &encoded);
+                break;
+            case Format::Png:
+#ifdef HAVE_ZLIB
+                ok = encodePng(data->data(), width, height, &encoded);
+#endif
+                break;
+        }
+        ok = ok && writeAll(fd, encoded);
+        close(fd);
+        return ok;
+    }, done);
+}
+
+static void putBigEndian(std::vector<uint8_t> *out, uint32_t v)
+{
+    out->push_back(v >> 24);
+    out->push_back(v >> 16);
+    out->push_back(v >> 8);
+    out->push_back(v);
+}
+
+// See https://qoiformat.org/qoi-specification.pdf
+bool ImageEncoder::encodeQoi(const uint32_t *pixels, int32_t width, int32_t height, std::vector<uint8_t> *out)
+{
+    struct Rgba {
+        uint8_t r, g, b, a;
+        bool operator==(const Rgba &o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+    };
+
+    size_t count = (size_t)width * height;
+    out->clear();
+    out->reserve(14 + count + 8);
+    out->insert(out->end(), { 'q', 'o', 'i', 'f' });
+    putBigEndian(out, width);
+    putBigEndian(out, height);
+    out->push_back(3); // RGB
+    out->push_back(0); // sRGB with linear alpha
+
+    // The decoder starts with all the entries transparent black, while all
+    // the pixels here are opaque, so an entry never matches before it has
+    // been written.
+    Rgba index[64];
+    memset(index, 0, sizeof(index));
+    Rgba prev = { 0, 0, 0, 255 };
+    int run = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t p = pixels[i];
+        Rgba px = { (uint8_t)(p >> 16), (uint8_t)(p >> 8), (uint8_t)p, 255 };
+
+        if (px == prev) {
+            if (++run == 62 || i == count - 1) {
+                out->push_back(0xc0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            out->push_back(0xc0 | (run - 1));
+            run = 0;
+        }
+
+        int hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+        if (index[hash] == px) {
+            out->push_back(hash);
+        } else {
+            index[hash] = px;
+
+            int8_t vr = px.r - prev.r;
+            int8_t vg = px.g - prev.g;
+            int8_t vb = px.b - prev.b;
+            int8_t vgr = vr - vg;
+            int8_t vgb = vb - vg;
+
+            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                out->push_back(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+            } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                out->push_back(0x80 | (vg + 32));
+                out->push_back((vgr + 8) << 4 | (vgb + 8));
+            } else {
+                out->push_back(0xfe);
+                out->push_back(px.r);
+                out->push_back(px.g);
+                out->push_back(px.b);
+            }
+        }
+        prev = px;
+    }
+
+    out->insert(out->end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+    return true;
+}
+
+#ifdef HAVE_ZLIB
+static void putPngChunk(std::vector<uint8_t> *out, const char *type, const uint8_t *data, size_t size)
+{
+    putBigEndian(out, size);
+    size_t start = out->size();
+    out->insert(out->end(), type, type + 4);
+    out->insert(out->end(), data, data + size);
+    putBigEndian(out, crc32(0, out->data() + start, size + 4));
+}
+
+bool ImageEncoder::encodePng(const uint32_t *pixels, int32_t width, int32_t height, std::vector<uint8_t> *out)
+{
+    // Every row is prefixed by the filter type. The Sub filter is cheap and
+    // works well on screen content, which has many runs of the same color.
+    size_t rowSize = 1 + width * 3;
+    std::vector<uint8_t> raw(rowSize * height);
+    for (int32_t y = 0; y < height; ++y) {
+        uint8_t *row = &raw[y * rowSize];
+        const uint32_t *src = pixels + y * width;
+        row[0] = 1;
+        uint8_t pr = 0, pg = 0, pb = 0;
+        for (int32_t x = 0; x < width; ++x) {
+            uint8_t r = src[x] >> 16, g = src[x] >> 8, b = src[x];
+            row[1 + x * 3] = r - pr;
+            row[2 + x * 3] = g - pg;
+            row[3 + x * 3] = b - pb;
+            pr = r;
+            pg = g;
+            pb = b;
+        }
+    }
+
+    uLongf compressedSize = compressBound(raw.size());
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK) {
+        return false;
+    }
+
+    static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out->clear();
+    out->insert(out->end(), signature, signature + sizeof(signature));
+
+    std::vector<uint8_t> header;
+    putBigEndian(&header, width);
+    putBigEndian(&header, height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8 bit RGB, no interlacing
+    putPngChunk(out, "IHDR", header.data(), header.size());
+    putPngChunk(out, "IDAT", compressed.data(), compressedSize);
+    putPngChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+#endif
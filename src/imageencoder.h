@@ -0,0 +1,53 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEENCODER_H
+#define IMAGEENCODER_H
+
+#include <stdint.h>
+
+#include <vector>
+#include <functional>
+
+/*
+ * Encodes images in the WorkerPool and writes them to a file descriptor.
+ * The pixels are XRGB8888, the alpha channel is ignored. The callback is
+ * called back on the main loop when the file has been written.
+ */
+class ImageEncoder
+{
+public:
+    enum class Format {
+        Png = 0,
+        Qoi = 1
+    };
+
+    static bool isSupported(Format format);
+
+    /*
+     * Takes ownership of fd, which is closed when done.
+     */
+    static void encode(Format format, std::vector<uint32_t> &&pixels, int32_t width, int32_t height, int fd,
+                       const std::function<void (bool)> &done);
+
+    static bool encodeQoi(const uint32_t *pixels, int32_t width, int32_t height, std::vector<uint8_t> *out);
+#ifdef HAVE_ZLIB
+    static bool encodePng(const uint32_t *pixels, int32_t width, int32_t height, std::vector<uint8_t> *out);
+#endif
+};
+
+#endif
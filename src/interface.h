@@ -21,6 +21,8 @@
 #include <list>
 #include <type_traits>
 
+#include "objectstats.h"
+
 class Interface;
 
 class Object
@@ -40,7 +42,7 @@ private:
     bool m_deleting;
 };
 
-class Interface
+class Interface : public Counted<Interface>
 {
 public:
     Interface();
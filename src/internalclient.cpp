@@ -0,0 +1,108 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include <wayland-server.h>
+
+#include <weston/compositor.h>
+
+#include "internalclient.h"
+
+InternalClient::InternalClient(weston_compositor *ec)
+              : m_compositor(ec)
+              , m_client(nullptr)
+              , m_fd(-1)
+              , m_source(nullptr)
+              , m_nextId(2) // 1 is the wl_display
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+        weston_log("nuclear: cannot create the internal client socket.\n");
+        return;
+    }
+
+    m_client = wl_client_create(ec->wl_display, sv[0]);
+    if (!m_client) {
+        close(sv[0]);
+        close(sv[1]);
+        return;
+    }
+
+    m_fd = sv[1];
+    fcntl(m_fd, F_SETFL, O_NONBLOCK);
+
+    // Drain whatever the compositor sends, so that the socket buffer never fills up.
+    wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+    m_source = wl_event_loop_add_fd(loop, m_fd, WL_EVENT_READABLE, [](int fd, uint32_t mask, void *data) {
+        char buf[4096];
+        while (read(fd, buf, sizeof(buf)) > 0) {
+        }
+        return 1;
+    }, this);
+}
+
+InternalClient::~InternalClient()
+{
+    if (m_client) {
+        wl_client_destroy(m_client);
+    }
+    if (m_source) {
+        wl_event_source_remove(m_source);
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+weston_buffer *InternalClient::createBuffer(int32_t width, int32_t height, void **data, int32_t *stride)
+{
+    if (!m_client) {
+        return nullptr;
+    }
+
+    // Use ids in the client range, so that the resource can be looked up again.
+    uint32_t id = m_nextId++;
+    wl_shm_buffer *shm = wl_shm_buffer_create(m_client, id, width, height, width * 4, WL_SHM_FORMAT_ARGB8888);
+    if (!shm) {
+        return nullptr;
+    }
+
+    *data = wl_shm_buffer_get_data(shm);
+    *stride = wl_shm_buffer_get_stride(shm);
+    return weston_buffer_from_resource(wl_client_get_object(m_client, id));
+}
+
+weston_surface *InternalClient::createSurface(weston_buffer *buffer, int32_t width, int32_t height)
+{
+    weston_surface *surface = weston_surface_create(m_compositor);
+    if (!surface) {
+        return nullptr;
+    }
+
+    weston_buffer_reference(&surface->buffer_ref, buffer);
+    m_compositor->renderer->attach(surface, buffer);
+    surface->width = width;
+    surface->height = height;
+    pixman_region32_fini(&surface->input);
+    pixman_region32_init_rect(&surface->input, 0, 0, 0, 0);
+    weston_surface_damage(surface);
+
+    return surface;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNALCLIENT_H
+#define INTERNALCLIENT_H
+
+#include <stdint.h>
+
+struct wl_client;
+struct wl_event_source;
+struct weston_compositor;
+struct weston_buffer;
+struct weston_surface;
+
+/*
+ * A wl_client living inside the compositor, used to own buffers which are
+ * created by the shell itself instead of by a real client. Nothing reads
+ * from the other end of its socket, the events sent to it are discarded.
+ */
+class InternalClient
+{
+public:
+    InternalClient(weston_compositor *ec);
+    ~InternalClient();
+
+    inline wl_client *client() const { return m_client; }
+
+    /*
+     * Creates a new ARGB8888 shm buffer. 'data' and 'stride' are set to the
+     * buffer's storage, which can be written at any time.
+     */
+    weston_buffer *createBuffer(int32_t width, int32_t height, void **data, int32_t *stride);
+    /*
+     * Creates a surface showing the given buffer. The surface does not have
+     * an input region and is not mapped.
+     */
+    weston_surface *createSurface(weston_buffer *buffer, int32_t width, int32_t height);
+
+private:
+    weston_compositor *m_compositor;
+    wl_client *m_client;
+    int m_fd;
+    wl_event_source *m_source;
+    uint32_t m_nextId;
+};
+
+#endif
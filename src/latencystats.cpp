@@ -0,0 +1,96 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+
+#include <algorithm>
+#include <list>
+
+#include "latencystats.h"
+#include "statsinterface.h"
+
+// Enough for a stable p99, and small enough to sort on every query.
+static const size_t MaxSamples = 1024;
+
+static uint64_t currentTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static std::list<LatencyStats *> &allStats()
+{
+    static std::list<LatencyStats *> list;
+    return list;
+}
+
+LatencyStats::Measure::Measure(LatencyStats *stats)
+                     : m_stats(stats)
+                     , m_start(currentTime())
+{
+}
+
+LatencyStats::Measure::~Measure()
+{
+    m_stats->add(currentTime() - m_start);
+}
+
+LatencyStats::LatencyStats(const char *name)
+            : m_name(name)
+            , m_next(0)
+            , m_count(0)
+            , m_max(0)
+{
+    allStats().push_back(this);
+}
+
+void LatencyStats::init()
+{
+    StatsInterface::addProvider("latency", [](StatsSink *sink) {
+        for (LatencyStats *s: allStats()) {
+            sink->entry(s->m_name, "samples", (int32_t)std::min<uint64_t>(s->m_count, INT32_MAX));
+            sink->entry(s->m_name, "p50_us", (int32_t)s->percentile(50));
+            sink->entry(s->m_name, "p99_us", (int32_t)s->percentile(99));
+            sink->entry(s->m_name, "max_us", (int32_t)s->m_max);
+        }
+    });
+}
+
+void LatencyStats::add(uint64_t usecs)
+{
+    if (m_samples.size() < MaxSamples) {
+        m_samples.push_back(usecs);
+    } else {
+        m_samples[m_next] = usecs;
+        m_next = (m_next + 1) % MaxSamples;
+    }
+    ++m_count;
+    m_max = std::max(m_max, usecs);
+}
+
+uint64_t LatencyStats::percentile(int p) const
+{
+    if (m_samples.empty()) {
+        return 0;
+    }
+
+    std::vector<uint64_t> sorted(m_samples);
+    size_t n = (sorted.size() - 1) * p / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+    return sorted[n];
+}
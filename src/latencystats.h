@@ -0,0 +1,66 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ * Keeps the durations of the last operations of a kind, e.g. configuring
+ * a surface, and reports their percentiles in the "latency" category of
+ * the stats interface, to check how the shell scales with the number of
+ * windows and over long sessions.
+ */
+class LatencyStats
+{
+public:
+    /*
+     * Measures the time until it goes out of scope.
+     */
+    class Measure
+    {
+    public:
+        explicit Measure(LatencyStats *stats);
+        ~Measure();
+
+    private:
+        LatencyStats *m_stats;
+        uint64_t m_start;
+    };
+
+    explicit LatencyStats(const char *name);
+
+    static void init();
+
+    void add(uint64_t usecs);
+    /*
+     * In microseconds, over the last samples.
+     */
+    uint64_t percentile(int p) const;
+
+private:
+    const char *m_name;
+    std::vector<uint64_t> m_samples;
+    size_t m_next;
+    uint64_t m_count;
+    uint64_t m_max;
+};
+
+#endif
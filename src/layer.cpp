@@ -81,6 +81,31 @@ void Layer::show()
     }
 }
 
+void Layer::takeLayersBelow(struct weston_compositor *ec, struct wl_list *list)
+{
+    wl_list_init(list);
+
+    struct wl_list *head = &ec->layer_list;
+    struct wl_list *first = m_layer.link.next;
+    if (wl_list_empty(&m_layer.link) || first == head) {
+        return;
+    }
+    struct wl_list *last = head->prev;
+
+    m_layer.link.next = head;
+    head->prev = &m_layer.link;
+    list->next = first;
+    first->prev = list;
+    list->prev = last;
+    last->next = list;
+}
+
+void Layer::restoreLayersBelow(struct wl_list *list)
+{
+    wl_list_insert_list(&m_layer.link, list);
+    wl_list_init(list);
+}
+
 void Layer::addSurface(weston_view *view)
 {
     if (view->layer_link.link.prev) {
@@ -104,8 +129,7 @@ void Layer::stackAbove(weston_view *surf, weston_view *parent)
 void Layer::stackBelow(weston_view *surf, weston_view *parent)
 {
     weston_layer_entry_remove(&surf->layer_link);
-    weston_layer_entry *prev = container_of(parent->layer_link.link.prev->prev, weston_layer_entry, link);
-    weston_layer_entry_insert(prev, &surf->layer_link);
+    weston_layer_entry_insert(&parent->layer_link, &surf->layer_link);
 }
 
 void Layer::restack(weston_view *view)
@@ -68,6 +68,15 @@ public:
     void show();
     bool isVisible() const;
 
+    /*
+     * Moves all the layers below this one out of the compositor's layer
+     * list into 'list', keeping their order, and puts them back. The
+     * layers keep their position relative to each other meanwhile, so they
+     * can still be shown, hidden and reordered.
+     */
+    void takeLayersBelow(struct weston_compositor *ec, struct wl_list *list);
+    void restoreLayersBelow(struct wl_list *list);
+
     void addSurface(weston_view *surf);
     void addSurface(ShellSurface *surf);
     void restack(weston_view *surf);
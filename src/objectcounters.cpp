@@ -0,0 +1,63 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <cxxabi.h>
+
+#include <map>
+
+#include "objectstats.h"
+
+// The counters only need the standard library, unlike the reporting in
+// objectstats.cpp, so that they can be used without a compositor.
+
+// Never freed, the objects destroyed at exit still use them.
+static std::map<std::string, ObjectStats::Counter *> *s_counters = nullptr;
+
+ObjectStats::Counter *ObjectStats::counter(const std::string &name)
+{
+    if (!s_counters) {
+        s_counters = new std::map<std::string, Counter *>;
+    }
+    Counter *&c = (*s_counters)[name];
+    if (!c) {
+        c = new Counter;
+    }
+    return c;
+}
+
+std::string ObjectStats::typeName(const std::type_info &type)
+{
+    int status;
+    char *name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    if (!name) {
+        return type.name();
+    }
+    std::string str(name);
+    free(name);
+    return str;
+}
+
+void ObjectStats::forEach(const std::function<void (const std::string &name, const Counter &counter)> &func)
+{
+    if (!s_counters) {
+        return;
+    }
+    for (auto &i: *s_counters) {
+        func(i.first, *i.second);
+    }
+}
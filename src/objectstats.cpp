@@ -0,0 +1,89 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <weston/compositor.h>
+
+#include "objectstats.h"
+#include "statsinterface.h"
+#include "shell.h"
+
+// In kB, the second field of statm is the resident pages.
+static int32_t residentSize()
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) {
+        return 0;
+    }
+    long size, resident = 0;
+    if (fscanf(f, "%ld %ld", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void ObjectStats::init()
+{
+    StatsInterface::addProvider("objects", [](StatsSink *sink) {
+        ObjectStats::forEach([sink](const std::string &name, const Counter &c) {
+            sink->entry(name, "count", c.count());
+            sink->entry(name, "peak", c.peak());
+            sink->entry(name, "min_bytes", (int32_t)c.bytes());
+        });
+        sink->entry("process", "rss_kb", residentSize());
+    });
+
+    // SIGUSR1 is used by the compositor for the vt switching.
+    wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+    wl_event_loop_add_signal(loop, SIGUSR2, [](int, void *) {
+        ObjectStats::dump();
+        return 1;
+    }, nullptr);
+}
+
+void ObjectStats::countResource(wl_resource *resource, const wl_interface *interface)
+{
+    struct Tracker {
+        wl_listener listener;
+        Counter *counter;
+    };
+
+    Tracker *t = new Tracker;
+    t->counter = counter(interface->name);
+    t->counter->created(0);
+    t->listener.notify = [](wl_listener *listener, void *) {
+        Tracker *t = container_of(listener, Tracker, listener);
+        t->counter->destroyed(0);
+        delete t;
+    };
+    wl_resource_add_destroy_listener(resource, &t->listener);
+}
+
+void ObjectStats::dump()
+{
+    weston_log("nuclear: live objects\n");
+    size_t total = 0;
+    forEach([&total](const std::string &name, const Counter &c) {
+        weston_log_continue("  %-40s %8d (peak %d), at least %zu bytes\n", name.c_str(), c.count(), c.peak(), c.bytes());
+        total += c.bytes();
+    });
+    weston_log_continue("  total at least %zu bytes, resident size %d kB\n", total, residentSize());
+}
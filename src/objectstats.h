@@ -0,0 +1,95 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OBJECTSTATS_H
+#define OBJECTSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+#include <typeinfo>
+#include <functional>
+
+struct wl_resource;
+struct wl_interface;
+
+/*
+ * Counts the live objects of some types, and the protocol resources of
+ * some interfaces, to spot objects which outlive what they belong to.
+ * Only objects of the main thread are counted. The counts are in the
+ * "objects" category of the stats interface, and they are written to the
+ * log on SIGUSR2.
+ * The bytes are only a lower bound: an object counts as the size of the
+ * counted class, not of its subclasses, what the objects allocate
+ * themselves is not counted, and the resources count as zero bytes since
+ * libwayland owns them.
+ */
+class ObjectStats
+{
+public:
+    class Counter
+    {
+    public:
+        inline void created(size_t size) { m_bytes += size; if (++m_count > m_peak) m_peak = m_count; }
+        inline void destroyed(size_t size) { m_bytes -= size; --m_count; }
+
+        inline int32_t count() const { return m_count; }
+        inline int32_t peak() const { return m_peak; }
+        inline size_t bytes() const { return m_bytes; }
+
+    private:
+        Counter() : m_count(0), m_peak(0), m_bytes(0) {}
+
+        int32_t m_count;
+        int32_t m_peak;
+        size_t m_bytes;
+
+        friend class ObjectStats;
+    };
+
+    static void init();
+    static Counter *counter(const std::string &name);
+    static std::string typeName(const std::type_info &type);
+    /*
+     * Counts the resource under the name of its interface until it is destroyed.
+     */
+    static void countResource(wl_resource *resource, const wl_interface *interface);
+    static void forEach(const std::function<void (const std::string &name, const Counter &counter)> &func);
+    static void dump();
+};
+
+/*
+ * Inherit from this to have the objects of T counted under the name of T.
+ */
+template<class T>
+class Counted
+{
+protected:
+    Counted() { counter()->created(sizeof(T)); }
+    Counted(const Counted &) { counter()->created(sizeof(T)); }
+    ~Counted() { counter()->destroyed(sizeof(T)); }
+
+private:
+    static ObjectStats::Counter *counter()
+    {
+        static ObjectStats::Counter *c = ObjectStats::counter(ObjectStats::typeName(typeid(T)));
+        return c;
+    }
+};
+
+#endif
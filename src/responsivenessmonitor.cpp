@@ -0,0 +1,316 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+
+#include <string>
+#include <algorithm>
+
+#include <weston/compositor.h>
+
+#include "responsivenessmonitor.h"
+#include "statsinterface.h"
+#include "shell.h"
+#include "utils.h"
+
+static uint64_t currentTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct ResponsivenessMonitor::Client {
+    Client(wl_client *c)
+          : client(c)
+          , pingTimer(MinInterval)
+          , timeoutTimer(0)
+          , interval(MinInterval)
+          , responsive(true)
+          , pending(false)
+          , serial(0)
+          , sent(0)
+          , lastPong(currentTime())
+          , notifying(false)
+          , dead(false)
+          , pings(0)
+          , pongs(0)
+          , timeouts(0)
+          , lastLatency(0)
+          , maxLatency(0)
+          , totalLatency(0)
+    {
+    }
+
+    wl_client *client;
+    std::list<Pinger *> pingers;
+    Timer pingTimer;
+    Timer timeoutTimer;
+    int interval;
+    bool responsive;
+    bool pending;
+    uint32_t serial;
+    uint64_t sent;
+    uint64_t lastPong;
+    // Set while the pingers are being notified, so that the client is not
+    // deleted under our feet if they go away.
+    bool notifying;
+    bool dead;
+
+    uint32_t pings;
+    uint32_t pongs;
+    uint32_t timeouts;
+    uint32_t lastLatency;
+    uint32_t maxLatency;
+    uint64_t totalLatency;
+};
+
+ResponsivenessMonitor *ResponsivenessMonitor::instance()
+{
+    static ResponsivenessMonitor *monitor = new ResponsivenessMonitor;
+    return monitor;
+}
+
+ResponsivenessMonitor::ResponsivenessMonitor()
+                     : m_paused(0)
+{
+    StatsInterface::addProvider("responsiveness", [this](StatsSink *sink) {
+        for (auto &i: m_clients) {
+            Client *c = i.second;
+            pid_t pid;
+            wl_client_get_credentials(c->client, &pid, nullptr, nullptr);
+            std::string object = std::to_string(pid);
+            sink->entry(object, "responsive", c->responsive);
+            sink->entry(object, "interval_ms", c->interval);
+            sink->entry(object, "pings", c->pings);
+            sink->entry(object, "pongs", c->pongs);
+            sink->entry(object, "timeouts", c->timeouts);
+            sink->entry(object, "latency_last_us", c->lastLatency);
+            sink->entry(object, "latency_avg_us", c->pongs ? c->totalLatency / c->pongs : 0);
+            sink->entry(object, "latency_max_us", c->maxLatency);
+        }
+    });
+}
+
+void ResponsivenessMonitor::add(Pinger *p)
+{
+    Client *&c = m_clients[p->m_client];
+    if (!c) {
+        c = new Client(p->m_client);
+        Client *client = c;
+        c->pingTimer.triggered.connect([this, client]() {
+            client->pingTimer.stop();
+            ping(client);
+        });
+        c->timeoutTimer.triggered.connect([this, client]() { timeout(client); });
+        schedule(c);
+    }
+    c->pingers.push_back(p);
+    p->m_responsive = c->responsive;
+}
+
+void ResponsivenessMonitor::remove(Pinger *p)
+{
+    auto it = m_clients.find(p->m_client);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    Client *c = it->second;
+    c->pingers.remove(p);
+    if (c->pingers.empty()) {
+        m_clients.erase(it);
+        c->pingTimer.stop();
+        c->timeoutTimer.stop();
+        if (c->notifying) {
+            c->dead = true;
+        } else {
+            delete c;
+        }
+    }
+}
+
+void ResponsivenessMonitor::schedule(Client *c)
+{
+    if (m_paused) {
+        return;
+    }
+    c->pingTimer.stop();
+    c->pingTimer.setInterval(c->interval);
+    c->pingTimer.start();
+}
+
+void ResponsivenessMonitor::ping(Client *c)
+{
+    if (c->pending || m_paused) {
+        return;
+    }
+
+    int timeout = 0;
+    for (Pinger *p: c->pingers) {
+        timeout = std::max(timeout, p->pingTimeout());
+    }
+
+    c->pending = true;
+    c->serial = wl_display_next_serial(Shell::compositor()->wl_display);
+    c->sent = currentTime();
+    ++c->pings;
+    c->timeoutTimer.setInterval(timeout);
+    c->timeoutTimer.start();
+    // One surface is enough, the pong proves the whole client is alive.
+    c->pingers.front()->sendPing(c->serial);
+}
+
+void ResponsivenessMonitor::pong(Pinger *p, uint32_t serial)
+{
+    auto it = m_clients.find(p->m_client);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    Client *c = it->second;
+    if (!c->pending || c->serial != serial) {
+        // Just ignore unsolicited pongs.
+        return;
+    }
+
+    c->pending = false;
+    c->timeoutTimer.stop();
+    c->lastPong = currentTime();
+    uint32_t latency = c->lastPong - c->sent;
+    ++c->pongs;
+    c->lastLatency = latency;
+    c->maxLatency = std::max(c->maxLatency, latency);
+    c->totalLatency += latency;
+
+    if (c->responsive) {
+        c->interval = std::min(c->interval * 2, (int)MaxInterval);
+    } else {
+        c->interval = MinInterval;
+    }
+    schedule(c);
+    setResponsive(c, true);
+}
+
+void ResponsivenessMonitor::timeout(Client *c)
+{
+    c->timeoutTimer.stop();
+    ++c->timeouts;
+    // The ping stays pending, the client will answer it when it wakes up.
+    c->pingTimer.stop();
+    setResponsive(c, false);
+}
+
+void ResponsivenessMonitor::setResponsive(Client *c, bool responsive)
+{
+    if (c->responsive == responsive) {
+        return;
+    }
+
+    c->responsive = responsive;
+    c->notifying = true;
+    std::list<Pinger *> pingers = c->pingers;
+    for (Pinger *p: pingers) {
+        // A handler may destroy other surfaces of the client, or the client.
+        if (c->dead) {
+            break;
+        }
+        if (std::find(c->pingers.begin(), c->pingers.end(), p) == c->pingers.end()) {
+            continue;
+        }
+        p->m_responsive = responsive;
+        p->responsivenessChanged();
+    }
+    c->notifying = false;
+    if (c->dead) {
+        // We may be inside one of its timers' signal, delete it later.
+        wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+        wl_event_loop_add_idle(loop, [](void *data) { delete static_cast<Client *>(data); }, c);
+    }
+}
+
+void ResponsivenessMonitor::interaction(wl_client *client)
+{
+    auto it = m_clients.find(client);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    Client *c = it->second;
+    if (!c->pending && currentTime() - c->lastPong > (uint64_t)ProbeAge * 1000) {
+        c->pingTimer.stop();
+        ping(c);
+    }
+}
+
+
+
+void ResponsivenessMonitor::pause()
+{
+    if (m_paused++) {
+        return;
+    }
+
+    for (auto &i: m_clients) {
+        Client *c = i.second;
+        c->pingTimer.stop();
+        c->timeoutTimer.stop();
+        c->pending = false;
+    }
+}
+
+void ResponsivenessMonitor::resume()
+{
+    if (m_paused == 0 || --m_paused) {
+        return;
+    }
+
+    for (auto &i: m_clients) {
+        schedule(i.second);
+    }
+}
+
+
+
+ResponsivenessMonitor::Pinger::Pinger()
+                             : m_client(nullptr)
+                             , m_responsive(true)
+{
+}
+
+ResponsivenessMonitor::Pinger::~Pinger()
+{
+    if (m_client) {
+        ResponsivenessMonitor::instance()->remove(this);
+    }
+}
+
+void ResponsivenessMonitor::Pinger::watch(wl_client *client)
+{
+    if (m_client) {
+        ResponsivenessMonitor::instance()->remove(this);
+    }
+    m_client = client;
+    ResponsivenessMonitor::instance()->add(this);
+}
+
+void ResponsivenessMonitor::Pinger::handlePong(uint32_t serial)
+{
+    if (m_client) {
+        ResponsivenessMonitor::instance()->pong(this, serial);
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESPONSIVENESSMONITOR_H
+#define RESPONSIVENESSMONITOR_H
+
+#include <stdint.h>
+
+#include <list>
+#include <unordered_map>
+
+struct wl_client;
+class Timer;
+
+/*
+ * Checks that the clients are responsive by pinging them. The schedule is per
+ * client, whatever the number of its surfaces: a client which answers quickly
+ * is pinged less and less often, up to MaxInterval. A client is probed right
+ * away only when the user interacts with it and it has not shown signs of
+ * life for a while.
+ */
+class ResponsivenessMonitor
+{
+public:
+    /*
+     * Something which can ping a client, e.g. a shell surface.
+     */
+    class Pinger
+    {
+    public:
+        Pinger();
+        virtual ~Pinger();
+
+        bool isResponsive() const { return m_responsive; }
+
+    protected:
+        void watch(wl_client *client);
+        void handlePong(uint32_t serial);
+
+        virtual void sendPing(uint32_t serial) = 0;
+        virtual void responsivenessChanged() {}
+        virtual int pingTimeout() const { return 200; }
+
+    private:
+        wl_client *m_client;
+        bool m_responsive;
+
+        friend class ResponsivenessMonitor;
+    };
+
+    static ResponsivenessMonitor *instance();
+
+    /*
+     * The user is doing something with a surface of the client.
+     */
+    void interaction(wl_client *client);
+    /*
+     * Stops pinging until resume() is called as many times as pause().
+     * The pings in flight are forgotten.
+     */
+    void pause();
+    void resume();
+
+    static const int MinInterval = 1000;
+    static const int MaxInterval = 32000;
+    // How old the last pong must be for an interaction to trigger a ping.
+    static const int ProbeAge = 1000;
+
+private:
+    struct Client;
+
+    ResponsivenessMonitor();
+    void add(Pinger *p);
+    void remove(Pinger *p);
+    void pong(Pinger *p, uint32_t serial);
+    void ping(Client *c);
+    void timeout(Client *c);
+    void schedule(Client *c);
+    void setResponsive(Client *c, bool responsive);
+
+    std::unordered_map<wl_client *, Client *> m_clients;
+    int m_paused;
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <list>
+
+#include <weston/compositor.h>
+
+#include "screencast.h"
+#include "screenshooter.h"
+#include "shell.h"
+#include "utils.h"
+#include "objectstats.h"
+#include "wayland-screencast-server-protocol.h"
+
+class ScreencastStream : public Counted<ScreencastStream>
+{
+public:
+    ScreencastStream(wl_client *client, wl_resource *parent, uint32_t id, weston_output *output);
+    ~ScreencastStream();
+
+private:
+    struct Buffer {
+        weston_buffer_reference ref;
+        // What changed since the last time this buffer was written.
+        pixman_region32_t damage;
+        bool busy;
+    };
+
+    void destroy(wl_client *client, wl_resource *resource);
+    void addBuffer(wl_client *client, wl_resource *resource, wl_resource *buffer_resource);
+    void releaseBuffer(wl_client *client, wl_resource *resource, wl_resource *buffer_resource);
+    void frame(void *data);
+    void outputDestroyed(void *data);
+    void stop();
+    void removeBuffer(Buffer *b);
+    bool fitsOutput(wl_shm_buffer *shm) const;
+
+    wl_resource *m_resource;
+    weston_output *m_output;
+    std::list<Buffer *> m_buffers;
+    pixman_region32_t m_frameDamage;
+    WlListener m_frameListener;
+    WlListener m_outputDestroyListener;
+
+    static const struct nuclear_screencast_stream_interface s_implementation;
+};
+
+ScreencastStream::ScreencastStream(wl_client *client, wl_resource *parent, uint32_t id, weston_output *output)
+                : m_output(output)
+{
+    m_resource = wl_resource_create(client, &nuclear_screencast_stream_interface, wl_resource_get_version(parent), id);
+    wl_resource_set_implementation(m_resource, &s_implementation, this, [](wl_resource *res) {
+        delete static_cast<ScreencastStream *>(wl_resource_get_user_data(res));
+    });
+
+    pixman_region32_init(&m_frameDamage);
+    if (!output) {
+        // The output went away before the request came.
+        nuclear_screencast_stream_send_stopped(m_resource);
+        return;
+    }
+    m_frameListener.listen(&output->frame_signal);
+    m_frameListener.signal->connect(this, &ScreencastStream::frame);
+    m_outputDestroyListener.listen(&output->destroy_signal);
+    m_outputDestroyListener.signal->connect(this, &ScreencastStream::outputDestroyed);
+}
+
+ScreencastStream::~ScreencastStream()
+{
+    while (!m_buffers.empty()) {
+        removeBuffer(m_buffers.front());
+    }
+    pixman_region32_fini(&m_frameDamage);
+}
+
+void ScreencastStream::removeBuffer(Buffer *b)
+{
+    m_buffers.remove(b);
+    weston_buffer_reference(&b->ref, nullptr);
+    pixman_region32_fini(&b->damage);
+    delete b;
+}
+
+void ScreencastStream::destroy(wl_client *client, wl_resource *resource)
+{
+    wl_resource_destroy(resource);
+}
+
+void ScreencastStream::addBuffer(wl_client *client, wl_resource *resource, wl_resource *buffer_resource)
+{
+    weston_buffer *buffer = weston_buffer_from_resource(buffer_resource);
+    if (!buffer) {
+        wl_resource_post_no_memory(resource);
+        return;
+    }
+
+    wl_shm_buffer *shm = wl_shm_buffer_get(buffer_resource);
+    if (!m_output || !shm ||
+        (wl_shm_buffer_get_format(shm) != WL_SHM_FORMAT_ARGB8888 && wl_shm_buffer_get_format(shm) != WL_SHM_FORMAT_XRGB8888) ||
+        !fitsOutput(shm)) {
+        wl_resource_post_error(resource, NUCLEAR_SCREENCAST_ERROR_INVALID_BUFFER, "the buffer is not valid for this output");
+        return;
+    }
+
+    Buffer *b = new Buffer;
+    b->ref.buffer = nullptr;
+    weston_buffer_reference(&b->ref, buffer);
+    pixman_region32_init_rect(&b->damage, 0, 0, m_output->current_mode->width, m_output->current_mode->height);
+    b->busy = false;
+    m_buffers.push_back(b);
+
+    // Make sure the first frame comes even if nothing changes on the screen.
+    weston_output_damage(m_output);
+}
+
+bool ScreencastStream::fitsOutput(wl_shm_buffer *shm) const
+{
+    return wl_shm_buffer_get_width(shm) >= m_output->current_mode->width &&
+           wl_shm_buffer_get_height(shm) >= m_output->current_mode->height;
+}
+
+void ScreencastStream::releaseBuffer(wl_client *client, wl_resource *resource, wl_resource *buffer_resource)
+{
+    for (Buffer *b: m_buffers) {
+        if (b->ref.buffer && b->ref.buffer->resource == buffer_resource) {
+            b->busy = false;
+            return;
+        }
+    }
+}
+
+void ScreencastStream::frame(void *data)
+{
+    // The renderer stores here the damage it just repainted, in global coordinates.
+    int n;
+    pixman_box32_t *rects = pixman_region32_rectangles(&m_output->previous_damage, &n);
+    if (n == 0) {
+        return;
+    }
+
+    int32_t width = m_output->current_mode->width;
+    int32_t height = m_output->current_mode->height;
+
+    // The framebuffer is in the coordinates of the mode, which is scaled
+    // and may be rotated or flipped.
+    pixman_region32_t local, damage;
+    pixman_region32_init(&local);
+    pixman_region32_copy(&local, &m_output->previous_damage);
+    pixman_region32_translate(&local, -m_output->x, -m_output->y);
+    pixman_region32_init(&damage);
+    weston_transformed_region(m_output->width, m_output->height, (wl_output_transform)m_output->transform,
+                              m_output->current_scale, &local, &damage);
+    pixman_region32_fini(&local);
+    pixman_region32_intersect_rect(&damage, &damage, 0, 0, width, height);
+
+    pixman_region32_union(&m_frameDamage, &m_frameDamage, &damage);
+    Buffer *target = nullptr;
+    for (auto it = m_buffers.begin(); it != m_buffers.end();) {
+        Buffer *b = *it++;
+        if (!b->ref.buffer) {
+            // The client destroyed it.
+            removeBuffer(b);
+            continue;
+        }
+        if (!fitsOutput(wl_shm_buffer_get(b->ref.buffer->resource))) {
+            // The output switched to a bigger mode, e.g. for a fullscreen
+            // surface. The client has to start again with bigger buffers.
+            pixman_region32_fini(&damage);
+            stop();
+            return;
+        }
+        pixman_region32_union(&b->damage, &b->damage, &damage);
+        if (!target && !b->busy) {
+            target = b;
+        }
+    }
+    pixman_region32_fini(&damage);
+
+    if (!target) {
+        // The client is still busy with all the buffers, the damage is kept
+        // and sent with the next frame.
+        return;
+    }
+
+    wl_shm_buffer *shm = wl_shm_buffer_get(target->ref.buffer->resource);
+    rects = pixman_region32_rectangles(&target->damage, &n);
+    for (int i = 0; i < n; ++i) {
+        IRect2D rect(rects[i].x1, rects[i].y1, rects[i].x2 - rects[i].x1, rects[i].y2 - rects[i].y1);
+        Screenshooter::readPixels(m_output, rect, shm, rect.x, rect.y);
+    }
+    pixman_region32_clear(&target->damage);
+    target->busy = true;
+
+    wl_array array;
+    wl_array_init(&array);
+    rects = pixman_region32_rectangles(&m_frameDamage, &n);
+    for (int i = 0; i < n; ++i) {
+        int32_t *r = static_cast<int32_t *>(wl_array_add(&array, 4 * sizeof(int32_t)));
+        r[0] = rects[i].x1;
+        r[1] = rects[i].y1;
+        r[2] = rects[i].x2 - rects[i].x1;
+        r[3] = rects[i].y2 - rects[i].y1;
+    }
+    nuclear_screencast_stream_send_frame(m_resource, target->ref.buffer->resource, m_output->frame_time, &array);
+    wl_array_release(&array);
+    pixman_region32_clear(&m_frameDamage);
+
+    // Move it to the back of the ring, so that the buffers are used in turn.
+    m_buffers.remove(target);
+    m_buffers.push_back(target);
+}
+
+void ScreencastStream::outputDestroyed(void *data)
+{
+    stop();
+}
+
+void ScreencastStream::stop()
+{
+    m_frameListener.reset();
+    m_outputDestroyListener.reset();
+    m_output = nullptr;
+
+    while (!m_buffers.empty()) {
+        removeBuffer(m_buffers.front());
+    }
+    nuclear_screencast_stream_send_stopped(m_resource);
+}
+
+const struct nuclear_screencast_stream_interface ScreencastStream::s_implementation = {
+    wrapInterface(&ScreencastStream::destroy),
+    wrapInterface(&ScreencastStream::addBuffer),
+    wrapInterface(&ScreencastStream::releaseBuffer)
+};
+
+
+
+Screencast::Screencast()
+{
+    wl_global_create(Shell::instance()->compositor()->wl_display, &nuclear_screencast_interface, 1, this,
+                     [](wl_client *client, void *data, uint32_t version, uint32_t id) {
+                         static_cast<Screencast *>(data)->bind(client, version, id);
+                     });
+}
+
+void Screencast::bind(wl_client *client, uint32_t version, uint32_t id)
+{
+    wl_resource *resource = wl_resource_create(client, &nuclear_screencast_interface, version, id);
+
+    if (Shell::instance()->isTrusted(client, "nuclear_screencast")) {
+        wl_resource_set_implementation(resource, &s_implementation, this, nullptr);
+        ObjectStats::countResource(resource, &nuclear_screencast_interface);
+        return;
+    }
+
+    wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "permission to bind nuclear_screencast denied");
+    wl_resource_destroy(resource);
+}
+
+void Screencast::start(wl_client *client, wl_resource *resource, uint32_t id, wl_resource *output_resource)
+{
+    weston_output *output = static_cast<weston_output *>(wl_resource_get_user_data(output_resource));
+    new ScreencastStream(client, resource, id, output);
+}
+
+const struct nuclear_screencast_interface Screencast::s_implementation = {
+    wrapInterface(&Screencast::start)
+};
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCREENCAST_H
+#define SCREENCAST_H
+
+#include <wayland-server.h>
+
+#include "interface.h"
+
+class Screencast : public Interface
+{
+public:
+    Screencast();
+
+private:
+    void bind(wl_client *client, uint32_t version, uint32_t id);
+    void start(wl_client *client, wl_resource *resource, uint32_t id, wl_resource *output_resource);
+
+    static const struct nuclear_screencast_interface s_implementation;
+};
+
+#endif
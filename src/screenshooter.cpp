@@ -15,26 +15,94 @@
  * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+#include <algorithm>
+
 #include <weston/compositor.h>
 
 #include "screenshooter.h"
+#include "imageencoder.h"
 #include "shell.h"
+#include "objectstats.h"
 #include "wayland-screenshooter-server-protocol.h"
 
+struct Screenshooter::Capture : public Counted<Screenshooter::Capture> {
+    Capture(Screenshooter *s, wl_resource *res)
+        : shooter(s)
+        , resource(res)
+        , finished(false)
+        , failed(false)
+        , output(nullptr)
+        , frameListener(nullptr)
+        , outputDestroyListener(nullptr)
+        , fd(-1)
+    {
+        buffer.buffer = nullptr;
+    }
+    ~Capture()
+    {
+        delete frameListener;
+        delete outputDestroyListener;
+        weston_buffer_reference(&buffer, nullptr);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    Screenshooter *shooter;
+    wl_resource *resource;
+    bool finished;
+    bool failed;
+    weston_output *output;
+    weston_buffer_reference buffer;
+    int32_t x, y, width, height;
+    WlListener *frameListener;
+    WlListener *outputDestroyListener;
+    // Used instead of the buffer when encoding.
+    int fd;
+    ImageEncoder::Format format;
+};
+
 Screenshooter::Screenshooter()
 {
-    wl_global_create(Shell::instance()->compositor()->wl_display, &screenshooter_interface, 1, this,
+    wl_global_create(Shell::instance()->compositor()->wl_display, &screenshooter_interface, 3, this,
                      [](wl_client *client, void *data, uint32_t version, uint32_t id) {
                          static_cast<Screenshooter *>(data)->bind(client, version, id);
                      });
 }
 
+Screenshooter::~Screenshooter()
+{
+    // Their destructor calls unbind(), which removes them from the list.
+    while (!m_resources.empty()) {
+        wl_resource_destroy(m_resources.front());
+    }
+    for (Capture *c: m_captures) {
+        delete c;
+    }
+}
+
 void Screenshooter::bind(wl_client *client, uint32_t version, uint32_t id)
 {
     wl_resource *resource = wl_resource_create(client, &screenshooter_interface, version, id);
 
     if (Shell::instance()->isTrusted(client, "screenshooter")) {
-        wl_resource_set_implementation(resource, &s_implementation, this, nullptr);
+        wl_resource_set_implementation(resource, &s_implementation, this, [](wl_resource *res) {
+            static_cast<Screenshooter *>(wl_resource_get_user_data(res))->unbind(res);
+        });
+        m_resources.push_back(resource);
+        ObjectStats::countResource(resource, &screenshooter_interface);
+
+        if (version >= 3) {
+            for (ImageEncoder::Format f: { ImageEncoder::Format::Png, ImageEncoder::Format::Qoi }) {
+                if (ImageEncoder::isSupported(f)) {
+                    screenshooter_send_supported_format(resource, (uint32_t)f);
+                }
+            }
+        }
         return;
     }
 
@@ -42,19 +110,59 @@ void Screenshooter::bind(wl_client *client, uint32_t version, uint32_t id)
     wl_resource_destroy(resource);
 }
 
-static void done(void *data, weston_screenshooter_outcome outcome)
+void Screenshooter::unbind(wl_resource *resource)
+{
+    m_resources.remove(resource);
+    // The captures still running will be dropped silently once done.
+    for (Capture *c: m_captures) {
+        if (c->resource == resource) {
+            c->resource = nullptr;
+        }
+    }
+}
+
+Screenshooter::Capture *Screenshooter::newCapture(wl_resource *resource)
 {
-    wl_resource *resource = static_cast<wl_resource *>(data);
-
-    switch (outcome) {
-        case WESTON_SCREENSHOOTER_SUCCESS:
-            screenshooter_send_done(resource);
-            break;
-        case WESTON_SCREENSHOOTER_NO_MEMORY:
-            wl_resource_post_no_memory(resource);
-            break;
-        default:
-            break;
+    Capture *c = new Capture(this, resource);
+    m_captures.push_back(c);
+    return c;
+}
+
+void Screenshooter::finish(Capture *c)
+{
+    c->finished = true;
+    weston_buffer_reference(&c->buffer, nullptr);
+
+    // The done events must be sent in the same order as the requests, so a
+    // capture which is done before an older one of the same client must wait.
+    std::list<wl_resource *> blocked;
+    for (auto it = m_captures.begin(); it != m_captures.end();) {
+        Capture *capture = *it;
+        bool isBlocked = false;
+        for (wl_resource *r: blocked) {
+            if (r == capture->resource) {
+                isBlocked = true;
+                break;
+            }
+        }
+
+        if (!capture->finished || isBlocked) {
+            if (!isBlocked) {
+                blocked.push_back(capture->resource);
+            }
+            ++it;
+            continue;
+        }
+
+        // The clients older than version 3 do not know failed, and expect
+        // done for every request anyway.
+        if (capture->resource && capture->failed && wl_resource_get_version(capture->resource) >= 3) {
+            screenshooter_send_failed(capture->resource);
+        } else if (capture->resource) {
+            screenshooter_send_done(capture->resource);
+        }
+        it = m_captures.erase(it);
+        delete capture;
     }
 }
 
@@ -68,9 +176,264 @@ void Screenshooter::shoot(wl_client *client, wl_resource *resource, wl_resource
         return;
     }
 
-    weston_screenshooter_shoot(output, buffer, done, resource);
+    weston_screenshooter_shoot(output, buffer, [](void *data, weston_screenshooter_outcome outcome) {
+        Capture *c = static_cast<Capture *>(data);
+
+        switch (outcome) {
+            case WESTON_SCREENSHOOTER_SUCCESS:
+                break;
+            case WESTON_SCREENSHOOTER_NO_MEMORY:
+                if (c->resource) {
+                    wl_resource_post_no_memory(c->resource);
+                }
+                c->failed = true;
+                break;
+            default:
+                c->failed = true;
+                break;
+        }
+        c->shooter->finish(c);
+    }, newCapture(resource));
+}
+
+weston_buffer *Screenshooter::validateBuffer(wl_resource *resource, wl_resource *buffer_resource, int32_t width, int32_t height)
+{
+    weston_buffer *buffer = weston_buffer_from_resource(buffer_resource);
+    if (!buffer) {
+        wl_resource_post_no_memory(resource);
+        return nullptr;
+    }
+
+    wl_shm_buffer *shm = wl_shm_buffer_get(buffer_resource);
+    if (!shm || (wl_shm_buffer_get_format(shm) != WL_SHM_FORMAT_ARGB8888 && wl_shm_buffer_get_format(shm) != WL_SHM_FORMAT_XRGB8888) ||
+        wl_shm_buffer_get_width(shm) < width || wl_shm_buffer_get_height(shm) < height) {
+        wl_resource_post_error(resource, SCREENSHOOTER_ERROR_INVALID_BUFFER, "the buffer is not valid for this capture");
+        return nullptr;
+    }
+
+    return buffer;
+}
+
+void Screenshooter::shootRegion(wl_client *client, wl_resource *resource, wl_resource *output_resource, wl_resource *buffer_resource,
+                                int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    weston_output *output = static_cast<weston_output *>(wl_resource_get_user_data(output_resource));
+
+    if (width <= 0 || height <= 0 || x < 0 || y < 0 ||
+        x + width > output->current_mode->width || y + height > output->current_mode->height) {
+        wl_resource_post_error(resource, SCREENSHOOTER_ERROR_INVALID_REGION, "the region is not inside the output");
+        return;
+    }
+
+    weston_buffer *buffer = validateBuffer(resource, buffer_resource, width, height);
+    if (!buffer) {
+        return;
+    }
+
+    captureRegion(newCapture(resource), output, buffer, x, y, width, height);
+}
+
+void Screenshooter::shootSurface(wl_client *client, wl_resource *resource, wl_resource *surface_resource, wl_resource *buffer_resource)
+{
+    weston_surface *surface = static_cast<weston_surface *>(wl_resource_get_user_data(surface_resource));
+    weston_buffer *content = surface->buffer_ref.buffer;
+    wl_shm_buffer *src = content ? wl_shm_buffer_get(content->resource) : nullptr;
+
+    if (src && (wl_shm_buffer_get_format(src) == WL_SHM_FORMAT_ARGB8888 || wl_shm_buffer_get_format(src) == WL_SHM_FORMAT_XRGB8888)) {
+        // The surface has the pixels in memory already, no need to wait for
+        // a repaint and to read back the whole framebuffer.
+        int32_t width = wl_shm_buffer_get_width(src);
+        int32_t height = wl_shm_buffer_get_height(src);
+        weston_buffer *buffer = validateBuffer(resource, buffer_resource, width, height);
+        if (!buffer) {
+            return;
+        }
+
+        wl_shm_buffer *dst = wl_shm_buffer_get(buffer_resource);
+        int32_t srcStride = wl_shm_buffer_get_stride(src);
+        int32_t dstStride = wl_shm_buffer_get_stride(dst);
+
+        wl_shm_buffer_begin_access(src);
+        wl_shm_buffer_begin_access(dst);
+        const char *s = static_cast<const char *>(wl_shm_buffer_get_data(src));
+        char *d = static_cast<char *>(wl_shm_buffer_get_data(dst));
+        for (int32_t i = 0; i < height; ++i) {
+            memcpy(d + i * dstStride, s + i * srcStride, width * 4);
+        }
+        wl_shm_buffer_end_access(dst);
+        wl_shm_buffer_end_access(src);
+
+        finish(newCapture(resource));
+        return;
+    }
+
+    weston_view *view = Shell::defaultView(surface);
+    weston_output *output = view ? view->output : nullptr;
+    if (!output) {
+        // Nothing to read from, leave the buffer as it is.
+        finish(newCapture(resource));
+        return;
+    }
+
+    pixman_box32_t *box = pixman_region32_extents(&view->transform.boundingbox);
+    int32_t scale = output->current_scale;
+    int32_t x1 = std::max(0, (box->x1 - output->x) * scale);
+    int32_t y1 = std::max(0, (box->y1 - output->y) * scale);
+    int32_t x2 = std::min(output->current_mode->width, (box->x2 - output->x) * scale);
+    int32_t y2 = std::min(output->current_mode->height, (box->y2 - output->y) * scale);
+    if (x2 <= x1 || y2 <= y1) {
+        finish(newCapture(resource));
+        return;
+    }
+
+    weston_buffer *buffer = validateBuffer(resource, buffer_resource, x2 - x1, y2 - y1);
+    if (!buffer) {
+        return;
+    }
+
+    captureRegion(newCapture(resource), output, buffer, x1, y1, x2 - x1, y2 - y1);
+}
+
+void Screenshooter::shootEncoded(wl_client *client, wl_resource *resource, wl_resource *output_resource,
+                                 int32_t x, int32_t y, int32_t width, int32_t height, uint32_t format, int32_t fd)
+{
+    weston_output *output = static_cast<weston_output *>(wl_resource_get_user_data(output_resource));
+
+    if (width == 0 && height == 0) {
+        x = y = 0;
+        width = output->current_mode->width;
+        height = output->current_mode->height;
+    }
+
+    if (format > (uint32_t)ImageEncoder::Format::Qoi || !ImageEncoder::isSupported((ImageEncoder::Format)format)) {
+        close(fd);
+        wl_resource_post_error(resource, SCREENSHOOTER_ERROR_UNSUPPORTED_FORMAT, "unsupported format %u", format);
+        return;
+    }
+    if (width <= 0 || height <= 0 || x < 0 || y < 0 ||
+        x + width > output->current_mode->width || y + height > output->current_mode->height) {
+        close(fd);
+        wl_resource_post_error(resource, SCREENSHOOTER_ERROR_INVALID_REGION, "the region is not inside the output");
+        return;
+    }
+
+    Capture *c = newCapture(resource);
+    c->fd = fd;
+    c->format = (ImageEncoder::Format)format;
+    captureRegion(c, output, nullptr, x, y, width, height);
+}
+
+void Screenshooter::captureRegion(Capture *c, weston_output *output, weston_buffer *buffer, int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    c->output = output;
+    c->x = x;
+    c->y = y;
+    c->width = width;
+    c->height = height;
+    weston_buffer_reference(&c->buffer, buffer);
+
+    // The pixels can only be read right after the output is repainted.
+    c->frameListener = new WlListener;
+    c->frameListener->signal->connect([this, c](void *) { readRegion(c); });
+    c->frameListener->listen(&output->frame_signal);
+    c->outputDestroyListener = new WlListener;
+    c->outputDestroyListener->signal->connect([this, c](void *) {
+        // Unplugged before it was repainted.
+        c->frameListener->reset();
+        c->outputDestroyListener->reset();
+        c->output = nullptr;
+        c->failed = true;
+        finish(c);
+    });
+    c->outputDestroyListener->listen(&output->destroy_signal);
+    weston_output_damage(output);
+}
+
+bool Screenshooter::readPixels(weston_output *output, const IRect2D &rect, wl_shm_buffer *dst, int32_t dstX, int32_t dstY)
+{
+    int32_t stride = wl_shm_buffer_get_stride(dst);
+
+    wl_shm_buffer_begin_access(dst);
+    char *data = static_cast<char *>(wl_shm_buffer_get_data(dst)) + dstY * stride + dstX * 4;
+    bool ret = readPixels(output, rect, data, stride);
+    wl_shm_buffer_end_access(dst);
+
+    return ret;
+}
+
+bool Screenshooter::readPixels(weston_output *output, const IRect2D &rect, void *dst, int32_t stride)
+{
+    weston_compositor *ec = output->compositor;
+    std::vector<uint32_t> pixels(rect.width * rect.height);
+    int32_t y = rect.y;
+    bool yflip = ec->capabilities & WESTON_CAP_CAPTURE_YFLIP;
+    if (yflip) {
+        y = output->current_mode->height - rect.y - rect.height;
+    }
+
+    if (ec->renderer->read_pixels(output, ec->read_format, pixels.data(), rect.x, y, rect.width, rect.height) < 0) {
+        return false;
+    }
+
+    bool swap = ec->read_format == PIXMAN_a8b8g8r8 || ec->read_format == PIXMAN_x8b8g8r8;
+    char *data = static_cast<char *>(dst);
+    for (int32_t i = 0; i < rect.height; ++i) {
+        const uint32_t *src = &pixels[(yflip ? rect.height - 1 - i : i) * rect.width];
+        uint32_t *d = reinterpret_cast<uint32_t *>(data + i * stride);
+        if (swap) {
+            for (int32_t j = 0; j < rect.width; ++j) {
+                uint32_t p = src[j];
+                d[j] = (p & 0xff00ff00) | ((p & 0xff) << 16) | ((p >> 16) & 0xff);
+            }
+        } else {
+            memcpy(d, src, rect.width * 4);
+        }
+    }
+
+    return true;
+}
+
+void Screenshooter::readRegion(Capture *c)
+{
+    c->frameListener->reset();
+    // The output is not used after this.
+    c->outputDestroyListener->reset();
+
+    if (c->fd >= 0) {
+        // Only the read back is done here, the slow part runs in the encoder thread.
+        std::vector<uint32_t> pixels(c->width * c->height);
+        if (!readPixels(c->output, IRect2D(c->x, c->y, c->width, c->height), pixels.data(), c->width * 4)) {
+            c->failed = true;
+            finish(c);
+            return;
+        }
+
+        int fd = c->fd;
+        c->fd = -1;
+        ImageEncoder::encode(c->format, std::move(pixels), c->width, c->height, fd, [this, c](bool ok) {
+            c->failed = !ok;
+            finish(c);
+        });
+        return;
+    }
+
+    weston_buffer *buffer = c->buffer.buffer;
+    if (!buffer) {
+        // The client destroyed the buffer in the meantime.
+        c->failed = true;
+        finish(c);
+        return;
+    }
+
+    if (!readPixels(c->output, IRect2D(c->x, c->y, c->width, c->height), wl_shm_buffer_get(buffer->resource), 0, 0)) {
+        c->failed = true;
+    }
+    finish(c);
 }
 
 const struct screenshooter_interface Screenshooter::s_implementation = {
-    wrapInterface(&Screenshooter::shoot)
+    wrapInterface(&Screenshooter::shoot),
+    wrapInterface(&Screenshooter::shootRegion),
+    wrapInterface(&Screenshooter::shootSurface),
+    wrapInterface(&Screenshooter::shootEncoded)
 };
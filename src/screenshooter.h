@@ -18,18 +18,52 @@
 #ifndef SCREENSHOOTER_H
 #define SCREENSHOOTER_H
 
+#include <list>
+
 #include <wayland-server.h>
 
 #include "interface.h"
+#include "utils.h"
+
+struct weston_output;
+struct weston_buffer;
+struct wl_shm_buffer;
 
 class Screenshooter : public Interface
 {
 public:
     Screenshooter();
+    ~Screenshooter();
+
+    /*
+     * Reads a rectangle of the output framebuffer, in its pixels, into the
+     * shm buffer at the given position. Must be called in a handler for the
+     * output frame_signal. The buffer must be XRGB8888 or ARGB8888 and big
+     * enough to contain the rectangle.
+     */
+    static bool readPixels(weston_output *output, const IRect2D &rect, wl_shm_buffer *dst, int32_t dstX, int32_t dstY);
+    static bool readPixels(weston_output *output, const IRect2D &rect, void *dst, int32_t stride);
 
 private:
+    struct Capture;
+
     void bind(wl_client *client, uint32_t version, uint32_t id);
+    void unbind(wl_resource *resource);
     void shoot(wl_client *client, wl_resource *resource, wl_resource *output_resource, wl_resource *buffer_resource);
+    void shootRegion(wl_client *client, wl_resource *resource, wl_resource *output_resource, wl_resource *buffer_resource,
+                     int32_t x, int32_t y, int32_t width, int32_t height);
+    void shootSurface(wl_client *client, wl_resource *resource, wl_resource *surface_resource, wl_resource *buffer_resource);
+    void shootEncoded(wl_client *client, wl_resource *resource, wl_resource *output_resource,
+                      int32_t x, int32_t y, int32_t width, int32_t height, uint32_t format, int32_t fd);
+
+    weston_buffer *validateBuffer(wl_resource *resource, wl_resource *buffer_resource, int32_t width, int32_t height);
+    Capture *newCapture(wl_resource *resource);
+    void captureRegion(Capture *c, weston_output *output, weston_buffer *buffer, int32_t x, int32_t y, int32_t width, int32_t height);
+    void readRegion(Capture *c);
+    void finish(Capture *c);
+
+    std::list<Capture *> m_captures;
+    std::list<wl_resource *> m_resources;
 
     static const struct screenshooter_interface s_implementation;
 };
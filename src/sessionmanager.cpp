@@ -25,6 +25,7 @@
 #include <unordered_set>
 
 #include "sessionmanager.h"
+#include "workerpool.h"
 
 SessionManager::SessionManager(const char *sessionFile)
               : m_sessionFile(sessionFile)
@@ -32,11 +33,26 @@ SessionManager::SessionManager(const char *sessionFile)
     printf("Using session file \"%s\".\n", sessionFile);
 }
 
-void SessionManager::restore()
+void SessionManager::restore(const std::function<void ()> &done)
 {
-    FILE *session = fopen(m_sessionFile.c_str(), "r");
+    std::string file = m_sessionFile;
+    WorkerPool::instance()->run<std::list<std::string>>([file]() { return read(file); },
+                                                        [this, done](std::list<std::string> cmds) {
+        for (const std::string &cmd: cmds) {
+            start(cmd.c_str());
+        }
+        if (done) {
+            done();
+        }
+    });
+}
+
+std::list<std::string> SessionManager::read(const std::string &sessionFile)
+{
+    std::list<std::string> cmds;
+    FILE *session = fopen(sessionFile.c_str(), "r");
     if (!session) {
-        return;
+        return cmds;
     }
 
     char buf[512];
@@ -48,18 +64,25 @@ void SessionManager::restore()
                     buf[i] = ' ';
                 }
             }
-            start(buf);
+            cmds.push_back(buf);
         } else {
             break;
         }
     }
 
     fclose(session);
+    return cmds;
 }
 
 void SessionManager::save(const std::list<pid_t> &list)
 {
-    FILE *session = fopen(m_sessionFile.c_str(), "w");
+    std::string file = m_sessionFile;
+    WorkerPool::instance()->run([file, list]() { write(file, list); });
+}
+
+void SessionManager::write(const std::string &sessionFile, const std::list<pid_t> &list)
+{
+    FILE *session = fopen(sessionFile.c_str(), "w");
     if (!session) {
         return;
     }
@@ -78,8 +101,15 @@ void SessionManager::save(const std::list<pid_t> &list)
     for (pid_t pid: pids) {
         sprintf(file, "/proc/%i/cmdline", pid);
         FILE *f = fopen(file, "r");
-        size_t size = fread(buf, 1, sizeof(buf), f);
+        if (!f) {
+            // It went away in the meantime.
+            continue;
+        }
+        size_t size = fread(buf, 1, sizeof(buf) - 1, f);
         fclose(f);
+        if (size == 0) {
+            continue;
+        }
         for (size_t i = 0; i < size; ++i) {
             if (buf[i] == '\0') {
                 buf[i] = ' ';
@@ -89,7 +119,7 @@ void SessionManager::save(const std::list<pid_t> &list)
         buf[size] = '\0';
 
         sprintf(file, "/proc/%i/exe", pid);
-        ssize_t ssize = readlink(file, path, sizeof(path));
+        ssize_t ssize = readlink(file, path, sizeof(path) - 1);
         if (ssize != -1) {
             path[ssize] = '\0';
             fputs(path, session);
@@ -20,16 +20,26 @@
 
 #include <string>
 #include <list>
+#include <functional>
 
+/*
+ * The session file is read and written in the WorkerPool, only the
+ * processes are started on the main loop.
+ */
 class SessionManager
 {
 public:
     SessionManager(const char *sessionFile);
 
-    void restore();
+    /*
+     * done is called when all the processes have been started.
+     */
+    void restore(const std::function<void ()> &done = nullptr);
     void save(const std::list<pid_t> &pids);
 
 private:
+    static std::list<std::string> read(const std::string &sessionFile);
+    static void write(const std::string &sessionFile, const std::list<pid_t> &pids);
     void start(const char *cmd);
 
     std::string m_sessionFile;
@@ -16,8 +16,24 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <vector>
+#include <mutex>
+
+#include <weston/compositor.h>
 
 #include "settings.h"
+#include "utils.h"
+#include "shell.h"
+#include "workerpool.h"
 
 Option::BindingValue::BindingValue(Binding::Type t, uint32_t f, uint32_t s)
                     : type((int)t)
@@ -95,6 +111,22 @@ void Option::BindingValue::bind(Binding *b) const
     }
 }
 
+void Option::BindingValue::forEach(const std::function<void (Binding::Type, uint32_t, weston_keyboard_modifier)> &func) const
+{
+    if (type & (int)Binding::Type::Key) {
+        func(Binding::Type::Key, value.key.key, value.key.mod);
+    }
+    if (type & (int)Binding::Type::Button) {
+        func(Binding::Type::Button, value.button.button, value.button.mod);
+    }
+    if (type & (int)Binding::Type::Axis) {
+        func(Binding::Type::Axis, value.axis.axis, value.axis.mod);
+    }
+    if (type & (int)Binding::Type::HotSpot) {
+        func(Binding::Type::HotSpot, (uint32_t)value.hotSpot, (weston_keyboard_modifier)0);
+    }
+}
+
 
 Option Option::string(const char *n)
 {
@@ -123,6 +155,8 @@ Option Option::binding(const char *n, Binding::Type allowable)
 
 Option::Option()
       : m_set(false)
+      , m_handle(0)
+      , m_allowableBinding((Binding::Type)0)
 {
 }
 
@@ -210,6 +244,11 @@ std::string Settings::path() const
 
 
 std::unordered_map<std::string, Settings *> SettingsManager::s_settings;
+std::vector<SettingsManager::Handle> SettingsManager::s_handles;
+std::list<SettingsSubscriber *> SettingsManager::s_subscribers;
+// Settings are registered by static initializers, so s_handles can only be
+// filled in init().
+static bool s_handlesReady = false;
 
 bool SettingsManager::addSettings(Settings *s)
 {
@@ -219,17 +258,57 @@ bool SettingsManager::addSettings(Settings *s)
     }
 
     s_settings[s->path()] = s;
+    if (s_handlesReady) {
+        addHandles(s);
+    }
     return true;
 }
 
+void SettingsManager::addHandles(Settings *s)
+{
+    std::string path = s->path();
+    for (auto &o: s->m_options) {
+        s_handles.push_back({ s, &o.second, path });
+        o.second.m_handle = s_handles.size();
+    }
+}
+
+uint32_t SettingsManager::handle(const char *path, const char *option)
+{
+    auto it = s_settings.find(path);
+    if (it == s_settings.end()) {
+        return 0;
+    }
+    auto o = it->second->m_options.find(option);
+    if (o == it->second->m_options.end()) {
+        return 0;
+    }
+    return o->second.m_handle;
+}
+
+const Option *SettingsManager::option(uint32_t handle)
+{
+    if (handle == 0 || handle > s_handles.size()) {
+        return nullptr;
+    }
+    return s_handles[handle - 1].option;
+}
+
+const std::string &SettingsManager::path(uint32_t handle)
+{
+    return s_handles[handle - 1].path;
+}
+
 bool SettingsManager::unSet(const char *path, const char *option)
 {
-    Settings *s = s_settings[path];
-    if (s) {
+    auto i = s_settings.find(path);
+    if (i != s_settings.end()) {
+        Settings *s = i->second;
         auto it = s->m_options.find(option);
         if (it != s->m_options.end()) {
             it->second.unSet();
             s->unSet(option);
+            changed(it->second.m_handle);
             return true;
         }
     }
@@ -238,13 +317,15 @@ bool SettingsManager::unSet(const char *path, const char *option)
 
 bool SettingsManager::set(const char *path, const char *option, const std::string &v)
 {
-    Settings *s = s_settings[path];
-    if (s) {
+    auto i = s_settings.find(path);
+    if (i != s_settings.end()) {
+        Settings *s = i->second;
         auto it = s->m_options.find(option);
         if (it != s->m_options.end() && it->second.m_type == Option::Type::String) {
             it->second.m_value.string = v;
             it->second.m_set = true;
             s->set(option, v);
+            changed(it->second.m_handle);
             return true;
         }
     }
@@ -253,13 +334,15 @@ bool SettingsManager::set(const char *path, const char *option, const std::strin
 
 bool SettingsManager::set(const char *path, const char *option, int v)
 {
-    Settings *s = s_settings[path];
-    if (s) {
+    auto i = s_settings.find(path);
+    if (i != s_settings.end()) {
+        Settings *s = i->second;
         auto it = s->m_options.find(option);
         if (it != s->m_options.end() && it->second.m_type == Option::Type::Int) {
             it->second.m_value.integer = v;
             it->second.m_set = true;
             s->set(option, v);
+            changed(it->second.m_handle);
             return true;
         }
     }
@@ -268,26 +351,608 @@ bool SettingsManager::set(const char *path, const char *option, int v)
 
 bool SettingsManager::set(const char *path, const char *option, const Option::BindingValue &v)
 {
-    Settings *s = s_settings[path];
-    if (s) {
+    auto i = s_settings.find(path);
+    if (i != s_settings.end()) {
+        Settings *s = i->second;
         auto it = s->m_options.find(option);
         if (it != s->m_options.end() && it->second.m_type == Option::Type::Binding && (int)it->second.m_allowableBinding & v.type) {
             it->second.m_value.binding.merge(v);
             it->second.m_set = true;
             s->set(option, it->second.m_value.binding);
+            changed(it->second.m_handle);
             return true;
         }
     }
     return false;
 }
 
+/*
+ * The settings are stored in a compact binary file, so that they can be read
+ * with a single mmap before the first frame. The file starts with a header of
+ * three uint32: magic, version and the number of records. Every record is:
+ *   uint16 path length, uint16 name length, uint8 type, path, name,
+ * followed by the value, which is an int32 for integers, an uint32 length and
+ * the bytes for strings, and eight uint32 (type, key, key modifier, button,
+ * button modifier, axis, axis modifier, hot spot) for bindings.
+ * Only the options which are set are stored.
+ */
+static const uint32_t s_storeMagic = 0x5445534e; // "NSET"
+static const uint32_t s_storeVersion = 1;
+
+struct StoredOption {
+    std::string path;
+    std::string name;
+    Option::Type type;
+    std::string string;
+    int integer;
+    uint32_t binding[8];
+};
+
+static std::list<StoredOption> s_stored;
+static bool s_restoring = false;
+static Timer *s_saveTimer = nullptr;
+// Only one write is in flight at a time, so that an older store never
+// replaces a newer one. The latest data which came in the meantime waits
+// here, and the task in flight writes it next. Shared with the worker.
+static struct {
+    std::mutex mutex;
+    bool running;
+    bool pending;
+    std::string path;
+    std::vector<uint8_t> data;
+} s_write;
+// The options changed since the subscribers were last notified.
+static std::vector<uint32_t> s_changed;
+static std::vector<bool> s_changedFlags;
+static wl_event_source *s_notifySource = nullptr;
+
+static std::string storePath()
+{
+    if (const char *file = getenv("NUCLEAR_SETTINGS_FILE")) {
+        return file;
+    }
+
+    std::string dir;
+    if (const char *config = getenv("XDG_CONFIG_HOME")) {
+        dir = config;
+    } else if (const char *home = getenv("HOME")) {
+        dir = std::string(home) + "/.config";
+    } else {
+        return std::string();
+    }
+    return dir + "/nuclear/settings";
+}
+
+class StoreReader
+{
+public:
+    StoreReader(const uint8_t *data, size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    bool read(void *dst, size_t size)
+    {
+        if (m_size - m_pos < size) {
+            return false;
+        }
+        memcpy(dst, m_data + m_pos, size);
+        m_pos += size;
+        return true;
+    }
+    bool read(std::string *dst, size_t size)
+    {
+        if (m_size - m_pos < size) {
+            return false;
+        }
+        dst->assign((const char *)m_data + m_pos, size);
+        m_pos += size;
+        return true;
+    }
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_pos;
+};
+
+static bool parseStore(const uint8_t *data, size_t size, std::list<StoredOption> *out)
+{
+    StoreReader reader(data, size);
+    uint32_t header[3];
+    if (!reader.read(header, sizeof(header)) || header[0] != s_storeMagic || header[1] != s_storeVersion) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header[2]; ++i) {
+        uint16_t pathLength, nameLength;
+        uint8_t type;
+        StoredOption o;
+        if (!reader.read(&pathLength, sizeof(pathLength)) || !reader.read(&nameLength, sizeof(nameLength)) ||
+            !reader.read(&type, sizeof(type)) || !reader.read(&o.path, pathLength) || !reader.read(&o.name, nameLength)) {
+            return false;
+        }
+
+        o.type = (Option::Type)type;
+        switch (o.type) {
+            case Option::Type::String: {
+                uint32_t length;
+                if (!reader.read(&length, sizeof(length)) || !reader.read(&o.string, length)) {
+                    return false;
+                }
+            } break;
+            case Option::Type::Int:
+                if (!reader.read(&o.integer, sizeof(o.integer))) {
+                    return false;
+                }
+                break;
+            case Option::Type::Binding:
+                if (!reader.read(o.binding, sizeof(o.binding))) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+        }
+        out->push_back(o);
+    }
+    return true;
+}
+
+template<class T>
+static void append(std::vector<uint8_t> *out, const T &v)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    out->insert(out->end(), p, p + sizeof(T));
+}
+
+static void serialize(const StoredOption &o, std::vector<uint8_t> *out)
+{
+    append<uint16_t>(out, o.path.size());
+    append<uint16_t>(out, o.name.size());
+    append<uint8_t>(out, (uint8_t)o.type);
+    out->insert(out->end(), o.path.begin(), o.path.end());
+    out->insert(out->end(), o.name.begin(), o.name.end());
+    switch (o.type) {
+        case Option::Type::String:
+            append<uint32_t>(out, o.string.size());
+            out->insert(out->end(), o.string.begin(), o.string.end());
+            break;
+        case Option::Type::Int:
+            append<int32_t>(out, o.integer);
+            break;
+        case Option::Type::Binding:
+            out->insert(out->end(), (const uint8_t *)o.binding, (const uint8_t *)(o.binding + 8));
+            break;
+    }
+}
+
+static bool writeStore(const std::string &path, const std::vector<uint8_t> &data)
+{
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos && slash > 0) {
+        // Create the containing directory, and its parent for ~/.config.
+        std::string dir = path.substr(0, slash);
+        size_t parent = dir.rfind('/');
+        if (parent != std::string::npos && parent > 0) {
+            mkdir(dir.substr(0, parent).c_str(), 0700);
+        }
+        mkdir(dir.c_str(), 0700);
+    }
+
+    // Write to a temporary file and rename it over the old one, so that a crash
+    // never leaves a truncated file behind.
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t r = write(fd, data.data() + written, data.size() - written);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            unlink(tmp.c_str());
+            return false;
+        }
+        written += r;
+    }
+
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) < 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
 void SettingsManager::init()
 {
+    for (auto &s: s_settings) {
+        addHandles(s.second);
+    }
+    s_handlesReady = true;
+
+    std::string path = storePath();
+    if (path.empty()) {
+        return;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            if (!parseStore(static_cast<const uint8_t *>(data), st.st_size, &s_stored)) {
+                weston_log("nuclear: the settings file '%s' is corrupted, ignoring it.\n", path.c_str());
+                s_stored.clear();
+            }
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+}
+
+void SettingsManager::restore()
+{
+    // Applying the stored values must not schedule a write of the same values.
+    s_restoring = true;
+    for (const StoredOption &o: s_stored) {
+        switch (o.type) {
+            case Option::Type::String:
+                set(o.path.c_str(), o.name.c_str(), o.string);
+                break;
+            case Option::Type::Int:
+                set(o.path.c_str(), o.name.c_str(), o.integer);
+                break;
+            case Option::Type::Binding: {
+                Option::BindingValue v;
+                v.type = o.binding[0];
+                v.value.key.key = o.binding[1];
+                v.value.key.mod = (weston_keyboard_modifier)o.binding[2];
+                v.value.button.button = o.binding[3];
+                v.value.button.mod = (weston_keyboard_modifier)o.binding[4];
+                v.value.axis.axis = o.binding[5];
+                v.value.axis.mod = (weston_keyboard_modifier)o.binding[6];
+                v.value.hotSpot = (Binding::HotSpot)o.binding[7];
+                set(o.path.c_str(), o.name.c_str(), v);
+            } break;
+        }
+    }
+    s_restoring = false;
+}
+
+void SettingsManager::changed(uint32_t handle)
+{
+    if (s_restoring) {
+        return;
+    }
+
+    if (handle && !s_subscribers.empty()) {
+        s_changedFlags.resize(s_handles.size() + 1);
+        if (!s_changedFlags[handle]) {
+            s_changedFlags[handle] = true;
+            s_changed.push_back(handle);
+        }
+        if (!s_notifySource) {
+            wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+            s_notifySource = wl_event_loop_add_idle(loop, [](void *) { SettingsManager::notify(); }, nullptr);
+        }
+    }
+
+    // Many options are usually changed in a row, write them all at once.
+    if (!s_saveTimer) {
+        s_saveTimer = new Timer(500);
+        s_saveTimer->triggered.connect([]() {
+            s_saveTimer->stop();
+            save();
+        });
+    }
+    if (!s_saveTimer->isRunning()) {
+        s_saveTimer->start();
+    }
+}
+
+void SettingsManager::notify()
+{
+    s_notifySource = nullptr;
+
+    std::vector<uint32_t> changed;
+    changed.swap(s_changed);
+    for (uint32_t handle: changed) {
+        s_changedFlags[handle] = false;
+    }
+
+    // A subscriber may go away while another one is being notified.
+    std::list<SettingsSubscriber *> subscribers = s_subscribers;
+    std::vector<uint32_t> handles;
+    for (SettingsSubscriber *s: subscribers) {
+        if (std::find(s_subscribers.begin(), s_subscribers.end(), s) == s_subscribers.end()) {
+            continue;
+        }
+
+        handles.clear();
+        for (uint32_t handle: changed) {
+            if (s->matches(s_handles[handle - 1].path)) {
+                handles.push_back(handle);
+            }
+        }
+        if (!handles.empty()) {
+            s->optionsChanged(handles);
+        }
+    }
+}
+
+static void writeInBackground(const std::string &path, const std::vector<uint8_t> &data)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_write.mutex);
+        s_write.pending = true;
+        s_write.path = path;
+        s_write.data = data;
+        if (s_write.running) {
+            return;
+        }
+        s_write.running = true;
+    }
+
+    // The failure is logged back on the main loop, where weston_log() and
+    // strerror() can be used.
+    typedef std::pair<std::string, int> Failure;
+    WorkerPool::instance()->run<Failure>([]() {
+        Failure failure("", 0);
+        std::unique_lock<std::mutex> lock(s_write.mutex);
+        while (s_write.pending) {
+            s_write.pending = false;
+            std::string path = s_write.path;
+            std::vector<uint8_t> data;
+            data.swap(s_write.data);
+            lock.unlock();
+            if (!writeStore(path, data)) {
+                failure = Failure(path, errno);
+            }
+            lock.lock();
+        }
+        s_write.running = false;
+        return failure;
+    }, [](Failure failure) {
+        if (failure.second) {
+            weston_log("nuclear: failed to write the settings to '%s': %s\n", failure.first.c_str(), strerror(failure.second));
+        }
+    });
+}
+
+void SettingsManager::save()
+{
+    std::string path = storePath();
+    if (path.empty()) {
+        return;
+    }
+
+    std::list<StoredOption> options;
+    for (auto &i: s_settings) {
+        for (auto &j: i.second->m_options) {
+            const Option &opt = j.second;
+            if (!opt.m_set) {
+                continue;
+            }
+
+            StoredOption o;
+            o.path = i.first;
+            o.name = opt.m_name;
+            o.type = opt.m_type;
+            switch (opt.m_type) {
+                case Option::Type::String:
+                    o.string = opt.m_value.string;
+                    break;
+                case Option::Type::Int:
+                    o.integer = opt.m_value.integer;
+                    break;
+                case Option::Type::Binding: {
+                    const Option::BindingValue &v = opt.m_value.binding;
+                    uint32_t binding[8] = { (uint32_t)v.type, v.value.key.key, (uint32_t)v.value.key.mod,
+                                            v.value.button.button, (uint32_t)v.value.button.mod,
+                                            v.value.axis.axis, (uint32_t)v.value.axis.mod, (uint32_t)v.value.hotSpot };
+                    memcpy(o.binding, binding, sizeof(binding));
+                } break;
+            }
+            options.push_back(o);
+        }
+    }
+    // Keep the values of settings which are not registered, e.g. because they
+    // belong to a plugin which is not loaded this time.
+    for (const StoredOption &o: s_stored) {
+        if (s_settings.find(o.path) == s_settings.end()) {
+            options.push_back(o);
+        }
+    }
+
+    std::vector<uint8_t> data;
+    append<uint32_t>(&data, s_storeMagic);
+    append<uint32_t>(&data, s_storeVersion);
+    append<uint32_t>(&data, options.size());
+    for (const StoredOption &o: options) {
+        serialize(o, &data);
+    }
+
+    // The data is serialized here, only the disk access is done in the background.
+    writeInBackground(path, data);
 }
 
 void SettingsManager::cleanup()
 {
+    if (s_saveTimer) {
+        if (s_saveTimer->isRunning()) {
+            s_saveTimer->stop();
+            save();
+        }
+        delete s_saveTimer;
+        s_saveTimer = nullptr;
+    }
+    // The last write may still be queued or in flight, the worker pool
+    // finishes it when it is cleaned up after this.
+    if (s_notifySource) {
+        wl_event_source_remove(s_notifySource);
+        s_notifySource = nullptr;
+    }
+
     for (auto &s: s_settings) {
         delete s.second;
     }
+    s_handles.clear();
+}
+
+
+
+SettingsTransaction::Change *SettingsTransaction::change(uint32_t handle, Option::Type type)
+{
+    const Option *o = SettingsManager::option(handle);
+    if (!o || o->m_type != type) {
+        return nullptr;
+    }
+    return &m_changes[handle];
+}
+
+bool SettingsTransaction::unSet(uint32_t handle)
+{
+    if (!SettingsManager::option(handle)) {
+        return false;
+    }
+
+    Change &c = m_changes[handle];
+    c = Change();
+    c.reset = true;
+    c.unset = true;
+    return true;
+}
+
+bool SettingsTransaction::set(uint32_t handle, const std::string &value)
+{
+    Change *c = change(handle, Option::Type::String);
+    if (!c) {
+        return false;
+    }
+    c->unset = false;
+    c->string = value;
+    return true;
+}
+
+bool SettingsTransaction::set(uint32_t handle, int value)
+{
+    Change *c = change(handle, Option::Type::Int);
+    if (!c) {
+        return false;
+    }
+    c->unset = false;
+    c->integer = value;
+    return true;
+}
+
+bool SettingsTransaction::set(uint32_t handle, const Option::BindingValue &value)
+{
+    const Option *o = SettingsManager::option(handle);
+    if (!o || o->m_type != Option::Type::Binding || !((int)o->m_allowableBinding & value.type)) {
+        return false;
+    }
+
+    Change *c = change(handle, Option::Type::Binding);
+    if (!c) {
+        return false;
+    }
+    c->unset = false;
+    c->binding.merge(value);
+    return true;
+}
+
+void SettingsTransaction::commit()
+{
+    if (m_changes.empty()) {
+        return;
+    }
+
+    // Store all the values first, then notify.
+    for (auto &i: m_changes) {
+        Option *o = SettingsManager::s_handles[i.first - 1].option;
+        const Change &c = i.second;
+        if (c.reset) {
+            o->unSet();
+        }
+        if (c.unset) {
+            continue;
+        }
+
+        o->m_set = true;
+        switch (o->m_type) {
+            case Option::Type::String: o->m_value.string = c.string; break;
+            case Option::Type::Int: o->m_value.integer = c.integer; break;
+            case Option::Type::Binding: o->m_value.binding.merge(c.binding); break;
+        }
+    }
+
+    for (auto &i: m_changes) {
+        const SettingsManager::Handle &h = SettingsManager::s_handles[i.first - 1];
+        if (i.second.unset) {
+            h.settings->unSet(h.option->m_name);
+            continue;
+        }
+        switch (h.option->m_type) {
+            case Option::Type::String: h.settings->set(h.option->m_name, h.option->m_value.string); break;
+            case Option::Type::Int: h.settings->set(h.option->m_name, h.option->m_value.integer); break;
+            case Option::Type::Binding: h.settings->set(h.option->m_name, h.option->m_value.binding); break;
+        }
+    }
+    for (auto &i: m_changes) {
+        SettingsManager::changed(i.first);
+    }
+
+    m_changes.clear();
+}
+
+
+
+SettingsSubscriber::SettingsSubscriber()
+{
+    SettingsManager::s_subscribers.push_back(this);
+}
+
+SettingsSubscriber::~SettingsSubscriber()
+{
+    SettingsManager::s_subscribers.remove(this);
+}
+
+void SettingsSubscriber::addPrefix(const std::string &prefix)
+{
+    if (std::find(m_prefixes.begin(), m_prefixes.end(), prefix) == m_prefixes.end()) {
+        m_prefixes.push_back(prefix);
+    }
+}
+
+void SettingsSubscriber::removePrefix(const std::string &prefix)
+{
+    m_prefixes.remove(prefix);
+}
+
+bool SettingsSubscriber::matches(const std::string &path) const
+{
+    for (const std::string &prefix: m_prefixes) {
+        if (matches(path, prefix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SettingsSubscriber::matches(const std::string &path, const std::string &prefix)
+{
+    if (prefix.empty() || path == prefix) {
+        return true;
+    }
+    return path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+           (path[prefix.size()] == '/' || prefix[prefix.size() - 1] == '/');
 }
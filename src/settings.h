@@ -19,7 +19,10 @@
 #define SETTINGS_H
 
 #include <list>
+#include <map>
+#include <functional>
 #include <string>
+#include <vector>
 #include <unordered_map>
 
 #include "binding.h"
@@ -41,6 +44,11 @@ public:
         static BindingValue hotSpot(Binding::HotSpot hs);
 
         void bind(Binding *b) const;
+        /*
+         * Calls func for every type the value is bound to, with the key, button,
+         * axis or hot spot and the modifiers.
+         */
+        void forEach(const std::function<void (Binding::Type type, uint32_t value, weston_keyboard_modifier mod)> &func) const;
 
     private:
         BindingValue(Binding::Type t, uint32_t f, uint32_t s);
@@ -68,6 +76,7 @@ public:
         friend struct Value;
         friend class Option;
         friend class SettingsManager;
+        friend class SettingsTransaction;
     };
 
     static Option string(const char *n);
@@ -99,15 +108,18 @@ private:
     };
 
     bool m_set;
+    uint32_t m_handle;
     std::string m_name;
     Type m_type;
     Binding::Type m_allowableBinding;
     Value m_value;
 
     friend class SettingsManager;
+    friend class SettingsTransaction;
 };
 
 class Settings;
+class SettingsSubscriber;
 class SettingsManager
 {
 public:
@@ -116,17 +128,106 @@ public:
     static bool set(const char *path, const char *option, int value);
     static bool set(const char *path, const char *option, const Option::BindingValue &value);
 
+    /*
+     * Loads the stored settings. They are applied by restore(), which must
+     * be called once the shell is initialized.
+     */
     static void init();
+    static void restore();
     static void cleanup();
 
     static const std::unordered_map<std::string, Settings *> &settings() { return s_settings; }
 
+    /*
+     * Every option has a handle, valid for the lifetime of the shell, which
+     * avoids looking it up by path and name. 0 is never a valid handle.
+     */
+    static uint32_t handle(const char *path, const char *option);
+    static uint32_t handleCount() { return s_handles.size(); }
+    static const Option *option(uint32_t handle);
+    static const std::string &path(uint32_t handle);
+
 private:
+    struct Handle {
+        Settings *settings;
+        Option *option;
+        std::string path;
+    };
+
     static bool addSettings(Settings *s);
+    static void addHandles(Settings *s);
+    static void changed(uint32_t handle);
+    static void save();
+    static void notify();
 
     static std::unordered_map<std::string, Settings *> s_settings;
+    static std::vector<Handle> s_handles;
+    static std::list<SettingsSubscriber *> s_subscribers;
 
     friend Settings;
+    friend class SettingsTransaction;
+    friend class SettingsSubscriber;
+};
+
+/*
+ * Gets notified of the changes to the options whose path is one of the
+ * prefixes or is below one of them, e.g. "effects" matches "effects/scale_effect"
+ * but "effects/scale" does not. An empty prefix matches every option.
+ * The changes are collected and delivered once per main loop iteration, and
+ * only to the subscribers interested in them.
+ */
+class SettingsSubscriber
+{
+public:
+    SettingsSubscriber();
+    virtual ~SettingsSubscriber();
+
+    void addPrefix(const std::string &prefix);
+    void removePrefix(const std::string &prefix);
+    bool matches(const std::string &path) const;
+    static bool matches(const std::string &path, const std::string &prefix);
+
+protected:
+    virtual void optionsChanged(const std::vector<uint32_t> &handles) = 0;
+
+private:
+    std::list<std::string> m_prefixes;
+
+    friend class SettingsManager;
+};
+
+/*
+ * Collects changes to many options and applies them when committed. Every
+ * option is changed only once, with its last value, and all the new values
+ * are stored before any Settings object is notified, so that e.g. an effect
+ * being enabled already sees its new bindings.
+ */
+class SettingsTransaction
+{
+public:
+    bool unSet(uint32_t handle);
+    bool set(uint32_t handle, const std::string &value);
+    bool set(uint32_t handle, int value);
+    bool set(uint32_t handle, const Option::BindingValue &value);
+
+    void commit();
+    void clear() { m_changes.clear(); }
+    bool isEmpty() const { return m_changes.empty(); }
+
+private:
+    struct Change {
+        Change() : reset(false), unset(false), integer(0) {}
+        bool reset;
+        bool unset;
+        std::string string;
+        int integer;
+        Option::BindingValue binding;
+    };
+
+    Change *change(uint32_t handle, Option::Type type);
+
+    // Ordered by handle, so that the options of a Settings object are together.
+    std::map<uint32_t, Change> m_changes;
 };
 
 
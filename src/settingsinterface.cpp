@@ -20,9 +20,48 @@
 #include "settings.h"
 #include "wayland-settings-server-protocol.h"
 
+static void sendValue(wl_resource *resource, uint32_t handle)
+{
+    const Option *option = SettingsManager::option(handle);
+    if (!option->isSet()) {
+        nuclear_settings_send_option_unset(resource, handle);
+        return;
+    }
+
+    switch (option->type()) {
+        case Option::Type::String:
+            nuclear_settings_send_option_string(resource, handle, option->valueAsString().c_str());
+            break;
+        case Option::Type::Int:
+            nuclear_settings_send_option_integer(resource, handle, option->valueAsInt());
+            break;
+        case Option::Type::Binding:
+            option->valueAsBinding().forEach([resource, handle](Binding::Type type, uint32_t value, weston_keyboard_modifier mod) {
+                nuclear_settings_send_option_binding(resource, handle, (uint32_t)type, value, mod);
+            });
+            break;
+    }
+}
+
+class SettingsInterface::Subscriber : public SettingsSubscriber
+{
+public:
+    Subscriber(wl_resource *res) : resource(res) {}
+
+    void optionsChanged(const std::vector<uint32_t> &handles) override
+    {
+        for (uint32_t handle: handles) {
+            sendValue(resource, handle);
+        }
+        nuclear_settings_send_changes_done(resource);
+    }
+
+    wl_resource *resource;
+};
+
 SettingsInterface::SettingsInterface()
 {
-    wl_global_create(Shell::instance()->compositor()->wl_display, &nuclear_settings_interface, 1, this,
+    wl_global_create(Shell::instance()->compositor()->wl_display, &nuclear_settings_interface, 3, this,
                      [](wl_client *client, void *data, uint32_t version, uint32_t id) {
                          static_cast<SettingsInterface *>(data)->bind(client, version, id);
                      });
@@ -33,24 +72,16 @@ void SettingsInterface::bind(wl_client *client, uint32_t version, uint32_t id)
     wl_resource *resource = wl_resource_create(client, &nuclear_settings_interface, version, id);
 
     if (Shell::instance()->isTrusted(client, "nuclear_settings")) {
-        wl_resource_set_implementation(resource, &s_implementation, this, nullptr);
-
-        for (auto &s: SettingsManager::settings()) {
-            for (const Option &option: s.second->options()) {
-                const std::string &path = s.second->path();
-                switch (option.type()) {
-                    case Option::Type::String:
-                        nuclear_settings_send_string_option(resource, path.c_str(), option.name().c_str());
-                        break;
-                    case Option::Type::Int:
-                        nuclear_settings_send_integer_option(resource, path.c_str(), option.name().c_str());
-                        break;
-                    case Option::Type::Binding:
-                        nuclear_settings_send_binding_option(resource, path.c_str(), option.name().c_str(), (int)option.allowableBindingTypes());
-                        break;
-                }
+        wl_resource_set_implementation(resource, &s_implementation, this, [](wl_resource *res) {
+            SettingsInterface *iface = static_cast<SettingsInterface *>(wl_resource_get_user_data(res));
+            iface->m_transactions.erase(res);
+            auto it = iface->m_subscribers.find(res);
+            if (it != iface->m_subscribers.end()) {
+                delete it->second;
+                iface->m_subscribers.erase(it);
             }
-        }
+        });
+        sendOptions(resource);
         return;
     }
 
@@ -58,39 +89,200 @@ void SettingsInterface::bind(wl_client *client, uint32_t version, uint32_t id)
     wl_resource_destroy(resource);
 }
 
+void SettingsInterface::sendOptions(wl_resource *resource)
+{
+    // Use the handles table instead of calling Settings::options(), which
+    // builds a new list every time.
+    bool handles = wl_resource_get_version(resource) >= 2;
+    for (uint32_t handle = 1; handle <= SettingsManager::handleCount(); ++handle) {
+        const Option *option = SettingsManager::option(handle);
+        const char *path = SettingsManager::path(handle).c_str();
+        const char *name = option->name().c_str();
+        if (handles) {
+            nuclear_settings_send_option(resource, handle, path, name, (uint32_t)option->type(), (int)option->allowableBindingTypes());
+            continue;
+        }
+
+        switch (option->type()) {
+            case Option::Type::String:
+                nuclear_settings_send_string_option(resource, path, name);
+                break;
+            case Option::Type::Int:
+                nuclear_settings_send_integer_option(resource, path, name);
+                break;
+            case Option::Type::Binding:
+                nuclear_settings_send_binding_option(resource, path, name, (int)option->allowableBindingTypes());
+                break;
+        }
+    }
+    if (handles) {
+        nuclear_settings_send_done(resource);
+    }
+}
+
+SettingsTransaction *SettingsInterface::transaction(wl_resource *resource)
+{
+    auto it = m_transactions.find(resource);
+    if (it == m_transactions.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
 void SettingsInterface::unset(wl_client *client, wl_resource *resource, const char *path, const char *name)
 {
+    if (SettingsTransaction *t = transaction(resource)) {
+        t->unSet(SettingsManager::handle(path, name));
+        return;
+    }
     SettingsManager::unSet(path, name);
 }
 
 void SettingsInterface::setString(wl_client *client, wl_resource *resource, const char *path, const char *name, const char *value)
 {
+    if (SettingsTransaction *t = transaction(resource)) {
+        t->set(SettingsManager::handle(path, name), std::string(value));
+        return;
+    }
     SettingsManager::set(path, name, value);
 }
 
 void SettingsInterface::setInt(wl_client *client, wl_resource *resource, const char *path, const char *name, int32_t value)
 {
+    if (SettingsTransaction *t = transaction(resource)) {
+        t->set(SettingsManager::handle(path, name), value);
+        return;
+    }
     SettingsManager::set(path, name, value);
 }
 
+void SettingsInterface::setBinding(wl_resource *resource, const char *path, const char *name, const Option::BindingValue &v)
+{
+    if (SettingsTransaction *t = transaction(resource)) {
+        t->set(SettingsManager::handle(path, name), v);
+        return;
+    }
+    SettingsManager::set(path, name, v);
+}
+
 void SettingsInterface::setKeyBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t key, uint32_t mod)
 {
-    SettingsManager::set(path, name, Option::BindingValue::key(key, (weston_keyboard_modifier)mod));
+    setBinding(resource, path, name, Option::BindingValue::key(key, (weston_keyboard_modifier)mod));
 }
 
 void SettingsInterface::setAxisBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t axis, uint32_t mod)
 {
-    SettingsManager::set(path, name, Option::BindingValue::axis(axis, (weston_keyboard_modifier)mod));
+    setBinding(resource, path, name, Option::BindingValue::axis(axis, (weston_keyboard_modifier)mod));
 }
 
 void SettingsInterface::setHotSpotBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t hotspot)
 {
-    SettingsManager::set(path, name, Option::BindingValue::hotSpot((Binding::HotSpot)hotspot));
+    setBinding(resource, path, name, Option::BindingValue::hotSpot((Binding::HotSpot)hotspot));
 }
 
 void SettingsInterface::setButtonBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t button, uint32_t mod)
 {
-    SettingsManager::set(path, name, Option::BindingValue::button(button, (weston_keyboard_modifier)mod));
+    setBinding(resource, path, name, Option::BindingValue::button(button, (weston_keyboard_modifier)mod));
+}
+
+void SettingsInterface::begin(wl_client *client, wl_resource *resource)
+{
+    if (transaction(resource)) {
+        wl_resource_post_error(resource, NUCLEAR_SETTINGS_ERROR_INVALID_TRANSACTION, "a transaction was already started");
+        return;
+    }
+    m_transactions.insert(std::make_pair(resource, SettingsTransaction()));
+}
+
+void SettingsInterface::commit(wl_client *client, wl_resource *resource)
+{
+    SettingsTransaction *t = transaction(resource);
+    if (!t) {
+        wl_resource_post_error(resource, NUCLEAR_SETTINGS_ERROR_INVALID_TRANSACTION, "no transaction was started");
+        return;
+    }
+    t->commit();
+    m_transactions.erase(resource);
+}
+
+void SettingsInterface::apply(wl_resource *resource, SettingsTransaction &t, bool valid)
+{
+    if (!valid) {
+        wl_resource_post_error(resource, NUCLEAR_SETTINGS_ERROR_INVALID_OPTION, "invalid option handle or value type");
+        return;
+    }
+    // Outside of a transaction every change is applied immediately.
+    if (&t != transaction(resource)) {
+        t.commit();
+    }
+}
+
+void SettingsInterface::unsetOption(wl_client *client, wl_resource *resource, uint32_t handle)
+{
+    SettingsTransaction single;
+    SettingsTransaction *t = transaction(resource);
+    SettingsTransaction &target = t ? *t : single;
+    apply(resource, target, target.unSet(handle));
+}
+
+void SettingsInterface::setOptionString(wl_client *client, wl_resource *resource, uint32_t handle, const char *value)
+{
+    SettingsTransaction single;
+    SettingsTransaction *t = transaction(resource);
+    SettingsTransaction &target = t ? *t : single;
+    apply(resource, target, target.set(handle, std::string(value)));
+}
+
+void SettingsInterface::setOptionInt(wl_client *client, wl_resource *resource, uint32_t handle, int32_t value)
+{
+    SettingsTransaction single;
+    SettingsTransaction *t = transaction(resource);
+    SettingsTransaction &target = t ? *t : single;
+    apply(resource, target, target.set(handle, value));
+}
+
+void SettingsInterface::setOptionBinding(wl_client *client, wl_resource *resource, uint32_t handle, uint32_t type, uint32_t value, uint32_t mod)
+{
+    weston_keyboard_modifier m = (weston_keyboard_modifier)mod;
+    if (type != NUCLEAR_SETTINGS_BINDING_TYPE_KEY && type != NUCLEAR_SETTINGS_BINDING_TYPE_BUTTON &&
+        type != NUCLEAR_SETTINGS_BINDING_TYPE_AXIS && type != NUCLEAR_SETTINGS_BINDING_TYPE_HOTSPOT) {
+        wl_resource_post_error(resource, NUCLEAR_SETTINGS_ERROR_INVALID_OPTION, "invalid binding type %u", type);
+        return;
+    }
+    Option::BindingValue v = type == NUCLEAR_SETTINGS_BINDING_TYPE_KEY ? Option::BindingValue::key(value, m) :
+                             type == NUCLEAR_SETTINGS_BINDING_TYPE_BUTTON ? Option::BindingValue::button(value, m) :
+                             type == NUCLEAR_SETTINGS_BINDING_TYPE_AXIS ? Option::BindingValue::axis(value, m) :
+                             Option::BindingValue::hotSpot((Binding::HotSpot)value);
+
+    SettingsTransaction single;
+    SettingsTransaction *t = transaction(resource);
+    SettingsTransaction &target = t ? *t : single;
+    apply(resource, target, target.set(handle, v));
+}
+
+void SettingsInterface::subscribe(wl_client *client, wl_resource *resource, const char *prefix)
+{
+    Subscriber *&subscriber = m_subscribers[resource];
+    if (!subscriber) {
+        subscriber = new Subscriber(resource);
+    }
+    subscriber->addPrefix(prefix);
+
+    std::string p = prefix;
+    for (uint32_t handle = 1; handle <= SettingsManager::handleCount(); ++handle) {
+        if (SettingsSubscriber::matches(SettingsManager::path(handle), p)) {
+            sendValue(resource, handle);
+        }
+    }
+    nuclear_settings_send_changes_done(resource);
+}
+
+void SettingsInterface::unsubscribe(wl_client *client, wl_resource *resource, const char *prefix)
+{
+    auto it = m_subscribers.find(resource);
+    if (it != m_subscribers.end()) {
+        it->second->removePrefix(prefix);
+    }
 }
 
 const struct nuclear_settings_interface SettingsInterface::s_implementation = {
@@ -100,5 +292,13 @@ const struct nuclear_settings_interface SettingsInterface::s_implementation = {
     wrapInterface(&SettingsInterface::setKeyBinding),
     wrapInterface(&SettingsInterface::setAxisBinding),
     wrapInterface(&SettingsInterface::setHotSpotBinding),
-    wrapInterface(&SettingsInterface::setButtonBinding)
+    wrapInterface(&SettingsInterface::setButtonBinding),
+    wrapInterface(&SettingsInterface::begin),
+    wrapInterface(&SettingsInterface::commit),
+    wrapInterface(&SettingsInterface::unsetOption),
+    wrapInterface(&SettingsInterface::setOptionString),
+    wrapInterface(&SettingsInterface::setOptionInt),
+    wrapInterface(&SettingsInterface::setOptionBinding),
+    wrapInterface(&SettingsInterface::subscribe),
+    wrapInterface(&SettingsInterface::unsubscribe)
 };
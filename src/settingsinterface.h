@@ -18,9 +18,12 @@
 #ifndef SETTINGSINTERFACE_H
 #define SETTINGSINTERFACE_H
 
+#include <unordered_map>
+
 #include <wayland-server.h>
 
 #include "interface.h"
+#include "settings.h"
 
 class SettingsInterface : public Interface
 {
@@ -36,6 +39,24 @@ private:
     void setAxisBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t axis, uint32_t mod);
     void setHotSpotBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t hotspot);
     void setButtonBinding(wl_client *client, wl_resource *resource, const char *path, const char *name, uint32_t button, uint32_t mod);
+    void begin(wl_client *client, wl_resource *resource);
+    void commit(wl_client *client, wl_resource *resource);
+    void unsetOption(wl_client *client, wl_resource *resource, uint32_t handle);
+    void setOptionString(wl_client *client, wl_resource *resource, uint32_t handle, const char *value);
+    void setOptionInt(wl_client *client, wl_resource *resource, uint32_t handle, int32_t value);
+    void setOptionBinding(wl_client *client, wl_resource *resource, uint32_t handle, uint32_t type, uint32_t value, uint32_t mod);
+    void subscribe(wl_client *client, wl_resource *resource, const char *prefix);
+    void unsubscribe(wl_client *client, wl_resource *resource, const char *prefix);
+
+    void sendOptions(wl_resource *resource);
+    void setBinding(wl_resource *resource, const char *path, const char *name, const Option::BindingValue &v);
+    SettingsTransaction *transaction(wl_resource *resource);
+    void apply(wl_resource *resource, SettingsTransaction &t, bool valid);
+
+    // The transactions started with begin, by resource.
+    std::unordered_map<wl_resource *, SettingsTransaction> m_transactions;
+    class Subscriber;
+    std::unordered_map<wl_resource *, Subscriber *> m_subscribers;
 
     static const struct nuclear_settings_interface s_implementation;
 };
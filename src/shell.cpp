@@ -32,6 +32,17 @@
 #include "animation.h"
 #include "interface.h"
 #include "settings.h"
+#include "internalclient.h"
+#include "cursortheme.h"
+#include "startuptimeline.h"
+#include "idlemanager.h"
+#include "gamemode.h"
+#include "responsivenessmonitor.h"
+#include "workerpool.h"
+#include "objectstats.h"
+#include "latencystats.h"
+
+static LatencyStats s_configureLatency("configure");
 
 ShellGrab::ShellGrab()
          : m_pointer(nullptr)
@@ -84,12 +95,24 @@ ShellGrab *ShellGrab::fromGrab(weston_pointer_grab *grab)
 
 void ShellGrab::setCursor(Cursor cursor)
 {
-    Shell::instance()->setGrabCursor(cursor);
-    weston_pointer_set_focus(pointer(), Shell::instance()->m_grabView, wl_fixed_from_int(0), wl_fixed_from_int(0));
+    Shell *shell = Shell::instance();
+    if (shell->m_cursorTheme && shell->m_cursorTheme->hasCursor(cursor)) {
+        // Clear the focus so that no client can replace the cursor during the grab.
+        weston_pointer_set_focus(pointer(), nullptr, wl_fixed_from_int(0), wl_fixed_from_int(0));
+        shell->m_cursorTheme->setCursor(pointer(), cursor);
+        return;
+    }
+
+    shell->setGrabCursor(cursor);
+    weston_pointer_set_focus(pointer(), shell->m_grabView, wl_fixed_from_int(0), wl_fixed_from_int(0));
 }
 
 void ShellGrab::unsetCursor()
 {
+    if (Shell::instance()->m_cursorTheme) {
+        Shell::instance()->m_cursorTheme->unsetCursor(pointer());
+    }
+
     wl_fixed_t sx, sy;
     weston_view *view = weston_compositor_pick_view(pointer()->seat->compositor, pointer()->x, pointer()->y, &sx, &sy);
 
@@ -172,7 +195,7 @@ void Shell::movePointer(weston_pointer *pointer, uint32_t time, wl_fixed_t fx, w
 {
     weston_pointer_move(pointer, fx, fy);
 
-    if (time - m_lastMotionTime < 1000) {
+    if (m_gameSurface || time - m_lastMotionTime < 1000) {
         return;
     }
 
@@ -228,30 +251,51 @@ const weston_pointer_grab_interface Shell::s_defaultPointerGrabInterface = {
 
 
 Shell::Shell(struct weston_compositor *ec)
-            : m_compositor(ec)
+            : m_child(new Child)
+            , m_standby(nullptr)
+            , m_compositor(ec)
+            , m_standbyEnabled(false)
+            , m_deathcount(0)
+            , m_deathstamp(0)
             , m_windowsMinimized(false)
             , m_quitting(false)
             , m_lastMotionTime(0)
             , m_enterHotZone(0)
             , m_grabView(nullptr)
+            , m_internalClient(nullptr)
+            , m_cursorTheme(nullptr)
+            , m_locked(false)
+            , m_lockSurface(nullptr)
+            , m_lockView(nullptr)
+            , m_limboHidden(false)
+            , m_fullscreenExclusive(false)
+            , m_fullscreenCheckPending(false)
+            , m_gameSurface(nullptr)
 {
     s_instance = this;
 
     srandom(weston_compositor_get_time());
-    m_child.shell = this;
-    m_child.desktop_shell = nullptr;
-    m_child.client = nullptr;
-    m_child.deathstamp = 0;
+    m_child->shell = this;
+    m_child->desktop_shell = nullptr;
+    m_child->client = nullptr;
+    m_child->process.pid = 0;
 
     SettingsManager::init();
 }
 
 Shell::~Shell()
 {
+    delete m_cursorTheme;
+    delete m_internalClient;
     SettingsManager::cleanup();
+    WorkerPool::cleanup();
+    TimerWheel::cleanup();
     free(m_clientPath);
-    if (m_child.client) {
-        kill(m_child.process.pid, SIGKILL);
+    if (m_child->client) {
+        kill(m_child->process.pid, SIGKILL);
+    }
+    if (m_standby && m_standby->client) {
+        kill(m_standby->process.pid, SIGKILL);
     }
 }
 
@@ -264,9 +308,27 @@ void Shell::init()
 {
     weston_compositor_set_default_pointer_grab(m_compositor, &s_defaultPointerGrabInterface);
 
+    TimerWheel::init(wl_display_get_event_loop(m_compositor->wl_display));
     m_destroyListener.listen(&m_compositor->destroy_signal);
     m_destroyListener.signal->connect(this, &Shell::destroy);
+    ObjectStats::init();
+    LatencyStats::init();
     m_grabViewDestroy.signal->connect(this, &Shell::grabViewDestroyed);
+    m_lockSurfaceDestroy.signal->connect(this, &Shell::lockSurfaceDestroyed);
+    wl_list_init(&m_lockedLayers);
+    wl_list_init(&m_fullscreenHiddenLayers);
+    m_outputCreatedListener.listen(&m_compositor->output_created_signal);
+    m_outputCreatedListener.signal->connect([this](void *) { scheduleFullscreenCheck(); });
+    GameMode::instance()->policyChanged.connect([this]() { scheduleFullscreenCheck(); });
+    weston_seat *seat;
+    wl_list_for_each(seat, &m_compositor->seat_list, link) {
+        seatCreated(seat);
+    }
+    m_seatCreatedListener.listen(&m_compositor->seat_created_signal);
+    m_seatCreatedListener.signal->connect([this](void *data) { seatCreated(static_cast<weston_seat *>(data)); });
+
+    m_internalClient = new InternalClient(m_compositor);
+    m_cursorTheme = new CursorTheme(m_internalClient);
 
     m_splashLayer.insert(&m_compositor->cursor_layer);
     m_overlayLayer.insert(&m_splashLayer);
@@ -275,6 +337,20 @@ void Shell::init()
     m_stickyLayer.insert(&m_panelsLayer);
     m_limboLayer.insert(&m_stickyLayer);
     m_backgroundLayer.insert(&m_limboLayer);
+    // The lock layer is the only one of ours that stays in the compositor
+    // while locked, so it must be above all of them.
+    m_lockLayer.insert(&m_compositor->cursor_layer);
+
+    // The minimized windows are not visible, so while idle take them out of
+    // the compositor, so that their clients don't get frame callbacks.
+    IdleManager::instance()->idleChanged.connect([this](bool idle) {
+        m_limboHidden = idle;
+        if (idle) {
+            m_limboLayer.hide();
+        } else {
+            m_limboLayer.show();
+        }
+    });
 
     m_currentWorkspace = 0;
 
@@ -303,6 +379,115 @@ void Shell::setSplash(weston_view *view)
     weston_surface_schedule_repaint(view->surface);
 }
 
+void Shell::lock()
+{
+    if (m_locked) {
+        return;
+    }
+    m_locked = true;
+
+    // Nobody would see the running animations, but they would keep the
+    // outputs repainting, so make them jump to the end.
+    weston_output *out;
+    wl_list_for_each(out, &m_compositor->output_list, link) {
+        Animation::finishAll(out);
+    }
+
+    m_lockLayer.takeLayersBelow(m_compositor, &m_lockedLayers);
+    weston_seat *seat;
+    wl_list_for_each(seat, &m_compositor->seat_list, link) {
+        weston_surface_activate(m_lockSurface, seat);
+    }
+    weston_compositor_damage_all(m_compositor);
+}
+
+void Shell::unlock()
+{
+    if (!m_locked) {
+        return;
+    }
+    m_locked = false;
+
+    if (m_lockSurface) {
+        m_lockSurfaceDestroy.reset();
+        m_lockSurface->configure = nullptr;
+        m_lockSurface->configure_private = nullptr;
+        if (m_lockView) {
+            weston_view_destroy(m_lockView);
+        }
+        m_lockSurface = nullptr;
+        m_lockView = nullptr;
+    }
+
+    m_lockLayer.restoreLayersBelow(&m_lockedLayers);
+    weston_compositor_damage_all(m_compositor);
+    activateWorkspace(nullptr);
+    scheduleFullscreenCheck();
+}
+
+bool Shell::setLockSurface(weston_surface *surface)
+{
+    if (m_lockSurface == surface) {
+        return true;
+    }
+    if (surface->configure) {
+        return false;
+    }
+    if (m_lockSurface) {
+        m_lockSurfaceDestroy.reset();
+        m_lockSurface->configure = nullptr;
+        if (m_lockView) {
+            weston_view_destroy(m_lockView);
+        }
+    }
+
+    m_lockSurface = surface;
+    m_lockView = nullptr;
+    m_lockSurfaceDestroy.listen(&surface->destroy_signal);
+    surface->configure = staticLockSurfaceConfigure;
+    surface->configure_private = this;
+
+    // Setting a lock surface locks the session, if it is not already.
+    lock();
+    return true;
+}
+
+void Shell::staticLockSurfaceConfigure(weston_surface *es, int32_t sx, int32_t sy)
+{
+    Shell *shell = static_cast<Shell *>(es->configure_private);
+    if (es->width == 0 || wl_list_empty(&shell->m_compositor->output_list)) {
+        return;
+    }
+
+    if (!shell->m_lockView) {
+        shell->m_lockView = weston_view_create(es);
+        shell->m_lockLayer.addSurface(shell->m_lockView);
+        weston_seat *seat;
+        wl_list_for_each(seat, &shell->m_compositor->seat_list, link) {
+            weston_surface_activate(es, seat);
+        }
+    }
+
+    weston_output *out = container_of(shell->m_compositor->output_list.next, weston_output, link);
+    weston_view_set_position(shell->m_lockView, out->x + (out->width - es->width) / 2,
+                                                out->y + (out->height - es->height) / 2);
+    weston_view_update_transform(shell->m_lockView);
+    weston_surface_damage(es);
+}
+
+void Shell::lockSurfaceDestroyed(void *)
+{
+    // The views are destroyed with the surface. The session stays locked,
+    // ask for a new one. If the client died, this is asked again to the one
+    // which replaces it.
+    m_lockSurfaceDestroy.reset();
+    m_lockSurface = nullptr;
+    m_lockView = nullptr;
+    if (m_locked) {
+        prepareLockSurface();
+    }
+}
+
 void Shell::addWorkspace(Workspace *ws)
 {
     for (auto &i: m_backgrounds) {
@@ -366,9 +551,13 @@ void Shell::quit()
 {
     m_quitting = true;
     wl_display_terminate(compositor()->wl_display);
-    if (m_child.client) {
-        wl_client_destroy(m_child.client);
-        kill(m_child.process.pid, SIGTERM);
+    if (m_child->client) {
+        wl_client_destroy(m_child->client);
+        kill(m_child->process.pid, SIGTERM);
+    }
+    if (m_standby && m_standby->client) {
+        wl_client_destroy(m_standby->client);
+        kill(m_standby->process.pid, SIGTERM);
     }
 }
 
@@ -394,6 +583,12 @@ weston_view *Shell::defaultView(const weston_surface *surface)
 
 void Shell::configureSurface(ShellSurface *surface, int32_t sx, int32_t sy)
 {
+    LatencyStats::Measure measure(&s_configureLatency);
+
+    if (surface->m_state.fullscreen || surface->m_nextState.fullscreen || m_fullscreenExclusive) {
+        scheduleFullscreenCheck();
+    }
+
     if (surface->width() == 0) {
         surface->unmapped();
         return;
@@ -417,8 +612,10 @@ void Shell::configureSurface(ShellSurface *surface, int32_t sx, int32_t sy)
                 surface->map(surface->view()->geometry.x + sx, surface->view()->geometry.y + sy);
         }
 
-        for (Effect *e: m_effects) {
-            e->addSurface(surface);
+        if (!m_gameSurface) {
+            for (Effect *e: m_effects) {
+                e->addSurface(surface);
+            }
         }
 
         if (surface->m_type == ShellSurface::Type::Popup ||
@@ -517,6 +714,8 @@ void Shell::configureSurface(ShellSurface *surface, int32_t sx, int32_t sy)
                 surface->m_surface->output = surface->m_output;
             }
         }
+
+        surface->geometryChangedSignal();
     }
 }
 
@@ -634,6 +833,149 @@ bool Shell::surfaceIsTopFullscreen(ShellSurface *surface)
     return top == surface->view();
 }
 
+void Shell::scheduleFullscreenCheck()
+{
+    if (m_fullscreenCheckPending) {
+        return;
+    }
+    // Wait for all the changes of this main loop iteration to be done.
+    m_fullscreenCheckPending = true;
+    wl_event_loop *loop = wl_display_get_event_loop(m_compositor->wl_display);
+    wl_event_loop_add_idle(loop, [](void *data) { static_cast<Shell *>(data)->updateFullscreenExclusive(); }, this);
+}
+
+void Shell::seatCreated(weston_seat *seat)
+{
+    ShellSeat::shellSeat(seat)->keyboardFocusSignal.connect([this](ShellSeat *, weston_keyboard *) { scheduleFullscreenCheck(); });
+}
+
+bool Shell::fullscreenCoversOutputs(wl_client *trusted) const
+{
+    if (wl_list_empty(&m_compositor->output_list)) {
+        return false;
+    }
+
+    weston_output *output;
+    wl_list_for_each(output, &m_compositor->output_list, link) {
+        weston_view *top = nullptr;
+        for (weston_view *view: m_fullscreenLayer) {
+            // Skip the black views, and the fullscreen surfaces of other outputs.
+            ShellSurface *shsurf = getShellSurface(view->surface);
+            if (shsurf && shsurf->m_state.fullscreen && shsurf->m_fullscreen.output == output) {
+                top = view;
+                break;
+            }
+        }
+        if (!top) {
+            return false;
+        }
+
+        if (trusted && top->surface->resource && wl_resource_get_client(top->surface->resource) == trusted) {
+            continue;
+        }
+
+        // The opaque region in global coordinates is only computed for
+        // views which are not transparent, nor rotated or scaled. Weston
+        // updates it at the next repaint, but the check runs before that,
+        // after the surface was configured or moved.
+        weston_view_update_transform(top);
+        pixman_box32_t box = { output->x, output->y, output->x + output->width, output->y + output->height };
+        if (pixman_region32_contains_rectangle(&top->transform.opaque, &box) != PIXMAN_REGION_IN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Shell::updateFullscreenExclusive()
+{
+    m_fullscreenCheckPending = false;
+    // The fullscreen layer is out of the compositor too while locked,
+    // unlock() checks again.
+    if (m_locked) {
+        return;
+    }
+
+    updateGameMode();
+
+    // A game gets the whole screen as soon as it is fullscreen on every
+    // output, without waiting for it to be opaque.
+    bool exclusive = fullscreenCoversOutputs(m_gameSurface ? m_gameSurface->client() : nullptr);
+    if (exclusive == m_fullscreenExclusive) {
+        return;
+    }
+    m_fullscreenExclusive = exclusive;
+
+    if (exclusive) {
+        m_fullscreenLayer.takeLayersBelow(m_compositor, &m_fullscreenHiddenLayers);
+    } else {
+        m_fullscreenLayer.restoreLayersBelow(&m_fullscreenHiddenLayers);
+        weston_compositor_damage_all(m_compositor);
+    }
+}
+
+void Shell::updateGameMode()
+{
+    // Stay with the current game while any seat has it focused, otherwise
+    // take the first focused surface which qualifies.
+    ShellSurface *candidate = nullptr;
+    weston_seat *seat;
+    wl_list_for_each(seat, &m_compositor->seat_list, link) {
+        weston_surface *focus = ShellSeat::shellSeat(seat)->currentKeyboardFocus();
+        ShellSurface *shsurf = focus ? getShellSurface(focus) : nullptr;
+        if (!GameMode::instance()->qualifies(shsurf)) {
+            continue;
+        }
+        if (shsurf == m_gameSurface) {
+            candidate = shsurf;
+            break;
+        }
+        if (!candidate) {
+            candidate = shsurf;
+        }
+    }
+
+    if (candidate == m_gameSurface) {
+        return;
+    }
+    if (m_gameSurface) {
+        leaveGameMode();
+    }
+    if (candidate) {
+        enterGameMode(candidate);
+    }
+}
+
+void Shell::enterGameMode(ShellSurface *surface)
+{
+    weston_log("nuclear: entering game mode for '%s'\n", surface->className().c_str());
+    m_gameSurface = surface;
+
+    weston_output *out;
+    wl_list_for_each(out, &m_compositor->output_list, link) {
+        Animation::finishAll(out);
+    }
+    for (Effect *e: m_effects) {
+        for (ShellSurface *s: m_surfaces) {
+            e->removeSurface(s);
+        }
+    }
+    ResponsivenessMonitor::instance()->pause();
+}
+
+void Shell::leaveGameMode()
+{
+    weston_log("nuclear: leaving game mode\n");
+    m_gameSurface = nullptr;
+
+    for (Effect *e: m_effects) {
+        for (ShellSurface *s: m_surfaces) {
+            e->addSurface(s);
+        }
+    }
+    ResponsivenessMonitor::instance()->resume();
+}
+
 bool Shell::isInFullscreen() const
 {
     return m_fullscreenLayer.isVisible();
@@ -670,15 +1012,24 @@ ShellSurface *Shell::getShellSurface(const struct weston_surface *surf)
 
 void Shell::removeShellSurface(ShellSurface *surface)
 {
-    for (Effect *e: m_effects) {
-        e->removeSurface(surface);
+    if (surface == m_gameSurface) {
+        leaveGameMode();
+    }
+    if (!m_gameSurface) {
+        for (Effect *e: m_effects) {
+            e->removeSurface(surface);
+        }
     }
     m_surfaces.remove(surface);
+    scheduleFullscreenCheck();
 }
 
 void Shell::registerEffect(Effect *effect)
 {
     m_effects.push_back(effect);
+    if (m_gameSurface) {
+        return;
+    }
     for (ShellSurface *s: m_surfaces) {
         effect->addSurface(s);
     }
@@ -947,7 +1298,11 @@ void Shell::activateWorkspace(Workspace *old)
     }
 
     currentWorkspace()->setActive(true);
-    currentWorkspace()->insert(&m_limboLayer);
+    currentWorkspace()->insert(workspacesAnchor());
+    if (m_locked) {
+        // The keyboard focus stays on the lock surface, unlock() calls this again.
+        return;
+    }
 
     for (const weston_view *view: currentWorkspace()->layer()) {
         ShellSurface *shsurf = getShellSurface(view->surface);
@@ -965,6 +1320,14 @@ void Shell::activateWorkspace(Workspace *old)
     }
 }
 
+Layer *Shell::workspacesAnchor()
+{
+    // While idle the limbo layer is out of the compositor, and inserting
+    // below it would link the workspaces to it only. It goes back right
+    // below the sticky layer, above the workspaces.
+    return m_limboHidden ? &m_stickyLayer : &m_limboLayer;
+}
+
 uint32_t Shell::numWorkspaces() const
 {
     return m_workspaces.size();
@@ -979,7 +1342,7 @@ void Shell::showAllWorkspaces()
         if (prev) {
             w->insert(prev);
         } else {
-            w->insert(&m_limboLayer);
+            w->insert(workspacesAnchor());
         }
         prev = w;
     }
@@ -1061,7 +1424,7 @@ void Shell::addStickyView(weston_view *v)
 
 bool Shell::isTrusted(wl_client *client, const char *interface) const
 {
-    return client == m_child.client;
+    return client == m_child->client || (m_standby && client == m_standby->client);
 }
 
 weston_output *Shell::outputAt(int x, int y) const
@@ -1076,44 +1439,150 @@ weston_output *Shell::outputAt(int x, int y) const
     return nullptr;
 }
 
-void Shell::sigchld(int status)
+bool Shell::registerDeath()
+{
+    /* if desktop-shell dies more than 5 times in 30 seconds, give up */
+    uint32_t time = weston_compositor_get_time();
+    if (time - m_deathstamp > 30000) {
+        m_deathstamp = time;
+        m_deathcount = 0;
+    }
+
+    m_deathcount++;
+    if (m_deathcount > 5) {
+        weston_log("weston-desktop-shell died, giving up.\n");
+        return false;
+    }
+    return true;
+}
+
+void Shell::sigchld(Child *child, int status)
 {
-    uint32_t time;
+    child->process.pid = 0;
+    child->client = nullptr; /* already destroyed by wayland */
 
-    m_child.process.pid = 0;
-    m_child.client = nullptr; /* already destroyed by wayland */
+    if (child != m_child && child != m_standby) {
+        // A client which was replaced by the standby one.
+        delete child;
+        return;
+    }
 
     if (m_quitting) {
         return;
     }
 
-    /* if desktop-shell dies more than 5 times in 30 seconds, give up */
-    time = weston_compositor_get_time();
-    if (time - m_child.deathstamp > 30000) {
-        m_child.deathstamp = time;
-        m_child.deathcount = 0;
+    if (child == m_standby) {
+        m_standby = nullptr;
+        delete child;
+        if (registerDeath()) {
+            launchStandbyProcess();
+        }
+        return;
     }
 
-    m_child.deathcount++;
-    if (m_child.deathcount > 5) {
-        weston_log("weston-desktop-shell died, giving up.\n");
+    if (child->desktop_shell) {
+        // Its socket has not hung up yet. Wait for its desktop_shell to be
+        // destroyed, see shellClientUnbound(), so that the new client does
+        // not get set up while the old resource is still around.
+        return;
+    }
+    replaceShellClient();
+}
+
+void Shell::shellClientUnbound()
+{
+    if (m_child->process.pid == 0) {
+        // The process is already gone, sigchld() waited for this.
+        replaceShellClient();
+    } else {
+        // If there is no standby client the process is relaunched when
+        // it exits.
+        promoteStandby();
+    }
+}
+
+void Shell::replaceShellClient()
+{
+    if (m_quitting) {
+        return;
+    }
+    if (m_standby && m_standby->desktop_shell) {
+        // promoteStandby() accounts for the death itself.
+        promoteStandby();
+        return;
+    }
+
+    if (!registerDeath()) {
         return;
     }
 
     weston_log("weston-desktop-shell died, respawning...\n");
-    launchShellProcess();
+    launch(m_child);
 }
 
-void Shell::launchShellProcess()
+void Shell::launch(Child *child)
 {
-    m_child.client = weston_client_launch(m_compositor,
-                                          &m_child.process,
-                                          m_clientPath,
-                                          [](struct weston_process *process, int status) {
-                                              Child *child = container_of(process, Child, process);
-                                              child->shell->sigchld(status);
-                                          });
+    child->client = weston_client_launch(m_compositor,
+                                         &child->process,
+                                         m_clientPath,
+                                         [](struct weston_process *process, int status) {
+                                             Child *child = container_of(process, Child, process);
+                                             child->shell->sigchld(child, status);
+                                         });
 
-    if (!m_child.client)
+    if (!child->client)
         weston_log("not able to start %s\n", m_clientPath);
 }
+
+void Shell::launchShellProcess()
+{
+    StartupTimeline::mark("launch_shell_client");
+    launch(m_child);
+    if (m_standbyEnabled) {
+        launchStandbyProcess();
+    }
+}
+
+void Shell::launchStandbyProcess()
+{
+    if (m_standby || !m_standbyEnabled) {
+        return;
+    }
+
+    m_standby = new Child;
+    m_standby->shell = this;
+    m_standby->desktop_shell = nullptr;
+    m_standby->process.pid = 0;
+    launch(m_standby);
+    if (!m_standby->client) {
+        delete m_standby;
+        m_standby = nullptr;
+    }
+}
+
+bool Shell::promoteStandby()
+{
+    // The standby client is usable only once it has bound desktop_shell.
+    if (m_quitting || !m_standby || !m_standby->desktop_shell) {
+        return false;
+    }
+    if (!registerDeath()) {
+        return false;
+    }
+
+    weston_log("weston-desktop-shell died, promoting the standby client.\n");
+    Child *old = m_child;
+    m_child = m_standby;
+    m_standby = nullptr;
+    if (old->process.pid == 0) {
+        delete old;
+    }
+    // Otherwise it is deleted when the process exits, see sigchld().
+
+    standbyPromoted();
+
+    // Start a new standby client once the promoted one is set up.
+    wl_event_loop *loop = wl_display_get_event_loop(m_compositor->wl_display);
+    wl_event_loop_add_idle(loop, [](void *data) { static_cast<Shell *>(data)->launchStandbyProcess(); }, this);
+    return true;
+}
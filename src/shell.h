@@ -34,6 +34,8 @@ class Effect;
 class Workspace;
 class ShellSeat;
 class Animation;
+class InternalClient;
+class CursorTheme;
 
 typedef std::list<ShellSurface *> ShellSurfaceList;
 
@@ -54,7 +56,7 @@ enum class Cursor {
 
 class Shell;
 
-class ShellGrab {
+class ShellGrab : public Counted<ShellGrab> {
 public:
     ShellGrab();
     virtual ~ShellGrab();
@@ -102,6 +104,11 @@ public:
     void quit();
 
     void launchShellProcess();
+    /*
+     * Keep a second shell client running but idle, which takes over right
+     * away if the current one crashes or hangs. Must be called before init().
+     */
+    void setStandbyClientEnabled(bool enabled) { m_standbyEnabled = enabled; }
     virtual ShellSurface *createShellSurface(weston_surface *surface, const weston_shell_client *client);
     void removeShellSurface(ShellSurface *surface);
     static ShellSurface *getShellSurface(const struct weston_surface *surf);
@@ -136,8 +143,8 @@ public:
     void minimizeWindows();
     void restoreWindows();
 
-    struct wl_client *shellClient() { return m_child.client; }
-    struct wl_resource *shellClientResource() { return m_child.desktop_shell; }
+    struct wl_client *shellClient() { return m_child->client; }
+    struct wl_resource *shellClientResource() { return m_child->desktop_shell; }
 
     static Shell *instance() { return s_instance; }
     inline static weston_compositor *compositor() { return instance()->m_compositor; }
@@ -147,18 +154,31 @@ public:
 
     void putInLimbo(ShellSurface *s);
     void addStickyView(weston_view *w);
+    void setSplash(weston_view *view);
+
+    /*
+     * While locked only the lock surface is shown, all the other layers are
+     * taken out of the compositor so that their surfaces are not repainted
+     * and don't get frame callbacks. unlock() puts them back as they were.
+     */
+    void lock();
+    void unlock();
+    inline bool isLocked() const { return m_locked; }
+    inline bool hasLockSurface() const { return m_lockSurface; }
+    bool setLockSurface(weston_surface *surface);
 
     virtual bool isTrusted(wl_client *client, const char *interface) const;
 
     weston_output *outputAt(int x, int y) const;
+    inline InternalClient *internalClient() const { return m_internalClient; }
 
 protected:
     Shell(struct weston_compositor *ec);
     virtual void init();
     inline const ShellSurfaceList &surfaces() const { return m_surfaces; }
     virtual void setGrabCursor(Cursor cursor) {}
+    virtual void prepareLockSurface() {}
     void addWorkspace(Workspace *ws);
-    void setSplash(weston_view *view);
     virtual void panelConfigure(struct weston_surface *es, int32_t sx, int32_t sy, PanelPosition pos);
 
     virtual void defaultPointerGrabFocus(weston_pointer_grab *grab);
@@ -171,11 +191,19 @@ protected:
         struct weston_process process;
         struct wl_client *client;
         struct wl_resource *desktop_shell;
-
-        unsigned deathcount;
-        uint32_t deathstamp;
     };
-    Child m_child;
+    // The standby client is launched like the active one, but it is not sent
+    // any state until it is promoted.
+    Child *m_child;
+    Child *m_standby;
+
+    bool promoteStandby();
+    virtual void standbyPromoted() {}
+    /*
+     * To be called when the desktop_shell resource of m_child is destroyed,
+     * after clearing it.
+     */
+    void shellClientUnbound();
 
     Layer m_backgroundLayer;
     Layer m_panelsLayer;
@@ -185,21 +213,40 @@ protected:
 
 private:
     void destroy(void *);
-    void sigchld(int status);
+    void sigchld(Child *child, int status);
+    void launch(Child *child);
+    void launchStandbyProcess();
+    bool registerDeath();
+    void replaceShellClient();
     void backgroundConfigure(struct weston_surface *es, int32_t sx, int32_t sy);
     void activateSurface(struct weston_seat *seat, uint32_t time, uint32_t button);
     void configureFullscreen(ShellSurface *surface);
     void stackFullscreen(ShellSurface *surface);
     weston_view *createBlackSurface(ShellSurface *fs_surface, float x, float y, int w, int h);
     bool surfaceIsTopFullscreen(ShellSurface *surface);
+    void scheduleFullscreenCheck();
+    /*
+     * The fullscreen surfaces of trusted don't need to be opaque.
+     */
+    bool fullscreenCoversOutputs(wl_client *trusted = nullptr) const;
+    void seatCreated(weston_seat *seat);
+    void updateFullscreenExclusive();
+    void updateGameMode();
+    void enterGameMode(ShellSurface *surface);
+    void leaveGameMode();
     void activateWorkspace(Workspace *old);
+    Layer *workspacesAnchor();
     weston_view *createBlackSurface(int x, int y, int w, int h);
     void workspaceRemoved(Workspace *ws);
     void grabViewDestroyed(void *d);
+    void lockSurfaceDestroyed(void *d);
 
     struct weston_compositor *m_compositor;
     WlListener m_destroyListener;
     char *m_clientPath;
+    bool m_standbyEnabled;
+    unsigned m_deathcount;
+    uint32_t m_deathstamp;
     Layer m_splashLayer;
     Layer m_limboLayer;
     std::vector<Effect *> m_effects;
@@ -217,8 +264,27 @@ private:
     std::list<weston_view *> m_blackSurfaces;
     weston_view *m_grabView;
     WlListener m_grabViewDestroy;
+    InternalClient *m_internalClient;
+    CursorTheme *m_cursorTheme;
+    Layer m_lockLayer;
+    wl_list m_lockedLayers;
+    bool m_locked;
+    weston_surface *m_lockSurface;
+    weston_view *m_lockView;
+    WlListener m_lockSurfaceDestroy;
+    bool m_limboHidden;
+    // When every output is covered by an opaque fullscreen surface the
+    // layers below the fullscreen one are taken out of the compositor.
+    wl_list m_fullscreenHiddenLayers;
+    bool m_fullscreenExclusive;
+    bool m_fullscreenCheckPending;
+    WlListener m_outputCreatedListener;
+    WlListener m_seatCreatedListener;
+    // The surface in game mode, see GameMode.
+    ShellSurface *m_gameSurface;
 
     static void staticPanelConfigure(weston_surface *es, int32_t sx, int32_t sy);
+    static void staticLockSurfaceConfigure(weston_surface *es, int32_t sx, int32_t sy);
 
     static const weston_pointer_grab_interface s_defaultPointerGrabInterface;
     static Shell *s_instance;
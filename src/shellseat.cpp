@@ -21,6 +21,9 @@
 #include "shellsurface.h"
 #include "workspace.h"
 #include "shell.h"
+#include "latencystats.h"
+
+static LatencyStats s_activateLatency("activate");
 
 class FocusState {
 public:
@@ -113,6 +116,12 @@ ShellSeat *ShellSeat::shellSeat(struct weston_seat *seat)
 
 void ShellSeat::activate(ShellSurface *shsurf)
 {
+    LatencyStats::Measure measure(&s_activateLatency);
+
+    // Nothing can take the keyboard from the lock surface.
+    if (Shell::instance()->isLocked()) {
+        return;
+    }
     weston_surface_activate(shsurf ? shsurf->weston_surface() : nullptr, m_seat);
     if (shsurf && shsurf->workspace()) {
         shsurf->workspace()->restack(shsurf);
@@ -122,6 +131,11 @@ void ShellSeat::activate(ShellSurface *shsurf)
 
 void ShellSeat::activate(weston_surface *surf)
 {
+    LatencyStats::Measure measure(&s_activateLatency);
+
+    if (Shell::instance()->isLocked()) {
+        return;
+    }
     weston_surface_activate(surf, m_seat);
     ShellSurface *shsurf = surf ? Shell::getShellSurface(surf) : nullptr;
     if (shsurf && shsurf->workspace()) {
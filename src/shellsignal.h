@@ -21,6 +21,8 @@
 #include <list>
 #include <functional>
 
+#include "objectstats.h"
+
 template<class... Args>
 class Functor;
 
@@ -28,6 +30,7 @@ template<class... Args>
 class Signal {
 public:
     Signal() : m_flush(false), m_calling(false) { }
+    ~Signal() { for (Functor *f: m_listeners) delete f; }
 
     template<class T> void connect(T *obj, void (T::*func)(Args...));
     void connect(const std::function<void (Args...)> &func);
@@ -42,13 +45,21 @@ public:
 private:
     class Functor {
     public:
-        Functor() : m_calling(false) {}
-        virtual ~Functor() {}
+        Functor() : m_calling(false) { counter()->created(sizeof(Functor)); }
+        virtual ~Functor() { counter()->destroyed(sizeof(Functor)); }
         virtual void call(Args...) = 0;
 
         bool m_called;
         bool m_toDelete;
         bool m_calling;
+
+    private:
+        // All the slots of all the signals are counted together.
+        static ObjectStats::Counter *counter()
+        {
+            static ObjectStats::Counter *c = ObjectStats::counter("Signal slot");
+            return c;
+        }
     };
 
     class FunctionFunctor : public Functor {
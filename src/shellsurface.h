@@ -25,6 +25,7 @@
 #include "shellsignal.h"
 #include "utils.h"
 #include "interface.h"
+#include "objectstats.h"
 
 struct weston_view;
 
@@ -33,7 +34,7 @@ class ShellSeat;
 class Workspace;
 class ShellGrab;
 
-class ShellSurface : public Object {
+class ShellSurface : public Object, public Counted<ShellSurface> {
 public:
     enum class Type {
         None,
@@ -77,6 +78,7 @@ public:
     inline bool isMaximized() const { return m_nextState.maximized; }
     inline bool isFullscreen() const { return m_nextState.fullscreen; }
     inline bool isTransient() const { return m_nextState.transient; }
+    inline const std::string &className() const { return m_class; }
 
     void addTransform(struct weston_transform *transform);
     void removeTransform(struct weston_transform *transform);
@@ -146,6 +148,8 @@ public:
     Signal<> activeChangedSignal;
     Signal<> mappedSignal;
     Signal<> unmappedSignal;
+    Signal<> geometryChangedSignal;
+    Signal<> workspaceChangedSignal;
 
 private:
     void internalUnsetFullscreen();
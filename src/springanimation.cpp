@@ -0,0 +1,171 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "springanimation.h"
+#include "animation.h"
+#include "animationgovernor.h"
+
+SpringAnimation::SpringAnimation()
+               : updateSignal(new Signal<float>())
+               , doneSignal(new Signal<>())
+               , m_value(0.f)
+               , m_velocity(0.f)
+               , m_target(0.f)
+               , m_restDistance(0.0005f)
+               , m_restVelocity(0.03f)
+               , m_lastPresentation(0)
+{
+    m_animation.parent = this;
+    wl_list_init(&m_animation.ani.link);
+    m_animation.ani.frame = frame;
+    setSettlingTime(200);
+}
+
+SpringAnimation::~SpringAnimation()
+{
+    stop();
+    updateSignal->flush();
+    doneSignal->flush();
+}
+
+void SpringAnimation::frame(struct weston_animation *base, struct weston_output *output, uint32_t msecs)
+{
+    AnimWrapper *animation = container_of(base, AnimWrapper, ani);
+    animation->parent->update(output, msecs);
+}
+
+SpringAnimation *SpringAnimation::fromAnimation(struct weston_animation *animation)
+{
+    if (animation->frame != frame) {
+        return nullptr;
+    }
+    return container_of(animation, AnimWrapper, ani)->parent;
+}
+
+void SpringAnimation::setValue(float value)
+{
+    m_value = value;
+    m_velocity = 0.f;
+}
+
+void SpringAnimation::setTarget(float value)
+{
+    m_target = value;
+}
+
+void SpringAnimation::setSettlingTime(uint32_t msecs)
+{
+    // A critically damped spring starting at rest is within 1% of the
+    // target after about 6.64 / omega.
+    m_omega = 6.64f * 1000.f / (msecs > 0 ? msecs : 1);
+}
+
+void SpringAnimation::setRestThreshold(float distance, float velocity)
+{
+    m_restDistance = distance;
+    m_restVelocity = velocity;
+}
+
+void SpringAnimation::run(struct weston_output *output)
+{
+    AnimationGovernor::instance()->animationStarted();
+    if (!output || Animation::isInstant()) {
+        stop();
+        m_value = m_target;
+        m_velocity = 0.f;
+        (*updateSignal)(m_value);
+        (*doneSignal)();
+        return;
+    }
+
+    if (isRunning()) {
+        return;
+    }
+
+    m_animation.ani.frame_counter = 0;
+    wl_list_insert(&output->animation_list, &m_animation.ani.link);
+    weston_compositor_schedule_repaint(output->compositor);
+}
+
+void SpringAnimation::stop()
+{
+    if (isRunning()) {
+        wl_list_remove(&m_animation.ani.link);
+        wl_list_init(&m_animation.ani.link);
+    }
+}
+
+void SpringAnimation::finish()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    stop();
+    m_value = m_target;
+    m_velocity = 0.f;
+    (*updateSignal)(m_value);
+    (*doneSignal)();
+}
+
+bool SpringAnimation::isRunning() const
+{
+    return m_animation.ani.link.next != &m_animation.ani.link;
+}
+
+void SpringAnimation::update(struct weston_output *output, uint32_t msecs)
+{
+    AnimationGovernor::instance()->frame(output, msecs);
+
+    // As in Animation, step to the time the frame will be presented.
+    int32_t refresh = output->current_mode && output->current_mode->refresh > 0 ? output->current_mode->refresh : 60000;
+    uint32_t presentation = msecs + 1000000 / refresh;
+    if (m_animation.ani.frame_counter <= 1) {
+        m_lastPresentation = msecs;
+    }
+    if (presentation == m_lastPresentation) {
+        weston_compositor_schedule_repaint(output->compositor);
+        return;
+    }
+    float dt = (presentation - m_lastPresentation) / 1000.f;
+    m_lastPresentation = presentation;
+
+    // The closed form solution of x'' = -omega^2 x - 2 omega x', with x
+    // the distance from the target. It is exact whatever dt is, so a
+    // late frame does not make it unstable.
+    float x = m_value - m_target;
+    float c = m_velocity + m_omega * x;
+    float e = expf(-m_omega * dt);
+    x = (x + c * dt) * e;
+    m_velocity = (m_velocity - m_omega * c * dt) * e;
+    m_value = m_target + x;
+
+    if (fabsf(x) < m_restDistance && fabsf(m_velocity) < m_restVelocity) {
+        stop();
+        m_value = m_target;
+        m_velocity = 0.f;
+        (*updateSignal)(m_value);
+        weston_compositor_schedule_repaint(output->compositor);
+        (*doneSignal)();
+        return;
+    }
+
+    (*updateSignal)(m_value);
+    weston_compositor_schedule_repaint(output->compositor);
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPRINGANIMATION_H
+#define SPRINGANIMATION_H
+
+#include <weston/compositor.h>
+
+#include "shellsignal.h"
+#include "objectstats.h"
+
+/*
+ * Moves a value toward a target as a critically damped spring, that is as
+ * fast as possible without overshooting. Unlike Animation it has no fixed
+ * duration: changing the target while running keeps the current velocity,
+ * so an interrupted animation turns around smoothly, and it stops asking
+ * for repaints as soon as it is at rest.
+ */
+class SpringAnimation : public Counted<SpringAnimation> {
+public:
+    SpringAnimation();
+    ~SpringAnimation();
+
+    /*
+     * Jumps to value, at rest.
+     */
+    void setValue(float value);
+    void setTarget(float value);
+    /*
+     * The time it takes to get within 1% of the target when starting at
+     * rest. The default is 200 ms.
+     */
+    void setSettlingTime(uint32_t msecs);
+    /*
+     * The animation is at rest when the distance from the target is below
+     * distance and the velocity, in units per second, below velocity.
+     * Pick them so that what is left cannot be seen, e.g. half a pixel,
+     * and half a pixel per frame. The defaults suit a range of 0 to 1
+     * mapped to about 1000 pixels.
+     */
+    void setRestThreshold(float distance, float velocity);
+
+    /*
+     * Starts moving toward the target, if it is not moving already.
+     */
+    void run(struct weston_output *output);
+    void stop();
+    void finish();
+    bool isRunning() const;
+
+    inline float value() const { return m_value; }
+    inline float velocity() const { return m_velocity; }
+
+    Signal<float> *updateSignal;
+    Signal<> *doneSignal;
+
+    /*
+     * The SpringAnimation which animation belongs to, if any.
+     */
+    static SpringAnimation *fromAnimation(struct weston_animation *animation);
+
+private:
+    static void frame(struct weston_animation *base, struct weston_output *output, uint32_t msecs);
+    void update(struct weston_output *output, uint32_t msecs);
+
+    struct AnimWrapper {
+        struct weston_animation ani;
+        SpringAnimation *parent;
+    };
+    AnimWrapper m_animation;
+    float m_value;
+    float m_velocity;
+    float m_target;
+    float m_omega;
+    float m_restDistance;
+    float m_restVelocity;
+    uint32_t m_lastPresentation;
+};
+
+#endif
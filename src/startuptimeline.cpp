@@ -0,0 +1,126 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include <weston/compositor.h>
+
+#include "startuptimeline.h"
+#include "statsinterface.h"
+
+struct Event {
+    const char *name;
+    char phase;
+    uint64_t time;
+};
+
+static std::vector<Event> s_events;
+static bool s_finished = false;
+
+static uint64_t currentTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void record(const char *name, char phase)
+{
+    if (s_finished) {
+        return;
+    }
+
+    if (s_events.empty()) {
+        s_events.reserve(32);
+        StatsInterface::addProvider("startup", [](StatsSink *sink) {
+            // The time of the end of the spans is not interesting, they
+            // are made of other marks.
+            for (const Event &e: s_events) {
+                if (e.phase != 'E') {
+                    sink->entry(e.name, "time_us", e.time - s_events.front().time);
+                }
+            }
+        });
+    }
+    s_events.push_back({ name, phase, currentTime() });
+}
+
+void StartupTimeline::mark(const char *name)
+{
+    record(name, 'i');
+}
+
+void StartupTimeline::begin(const char *name)
+{
+    record(name, 'B');
+}
+
+void StartupTimeline::end(const char *name)
+{
+    record(name, 'E');
+}
+
+static std::string tracePath()
+{
+    if (const char *file = getenv("NUCLEAR_STARTUP_TRACE")) {
+        return file;
+    }
+    if (const char *dir = getenv("XDG_RUNTIME_DIR")) {
+        return std::string(dir) + "/nuclear-startup.json";
+    }
+    return std::string();
+}
+
+void StartupTimeline::finish()
+{
+    if (s_finished || s_events.empty()) {
+        return;
+    }
+    s_finished = true;
+
+    uint64_t start = s_events.front().time;
+    weston_log("nuclear: the desktop was ready in %d ms.\n", (int)((s_events.back().time - start) / 1000));
+
+    std::string path = tracePath();
+    if (path.empty()) {
+        return;
+    }
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        weston_log("nuclear: cannot write the startup trace to '%s': %s\n", path.c_str(), strerror(errno));
+        return;
+    }
+
+    int pid = getpid();
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < s_events.size(); ++i) {
+        const Event &e = s_events[i];
+        fprintf(f, "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"%c\",%s\"ts\":%llu,\"pid\":%d,\"tid\":%d}%s\n",
+                e.name, e.phase, e.phase == 'i' ? "\"s\":\"p\"," : "", (unsigned long long)(e.time - start),
+                pid, pid, i + 1 < s_events.size() ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+}
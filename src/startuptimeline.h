@@ -0,0 +1,38 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+/*
+ * Records when the steps of the startup happen, from module_init to the
+ * moment the shell client says the desktop is ready. The timeline is
+ * written as a Chrome trace (chrome://tracing, or ui.perfetto.dev) to
+ * $NUCLEAR_STARTUP_TRACE, or to $XDG_RUNTIME_DIR/nuclear-startup.json, and
+ * it is also available as the "startup" category of nuclear_stats.
+ * Nothing is recorded after finish() is called.
+ */
+class StartupTimeline
+{
+public:
+    static void mark(const char *name);
+    static void begin(const char *name);
+    static void end(const char *name);
+    static void finish();
+};
+
+#endif
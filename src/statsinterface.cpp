@@ -0,0 +1,89 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+
+#include <weston/compositor.h>
+
+#include "statsinterface.h"
+#include "shell.h"
+#include "objectstats.h"
+#include "utils.h"
+#include "wayland-stats-server-protocol.h"
+
+// Ordered, so that the categories are always sent in the same order.
+static std::map<std::string, StatsInterface::Provider> s_providers;
+
+void StatsInterface::addProvider(const std::string &category, const Provider &provider)
+{
+    s_providers[category] = provider;
+}
+
+void StatsInterface::removeProvider(const std::string &category)
+{
+    s_providers.erase(category);
+}
+
+StatsInterface::StatsInterface()
+{
+    wl_global_create(Shell::instance()->compositor()->wl_display, &nuclear_stats_interface, 1, this,
+                     [](wl_client *client, void *data, uint32_t version, uint32_t id) {
+                         static_cast<StatsInterface *>(data)->bind(client, version, id);
+                     });
+}
+
+void StatsInterface::bind(wl_client *client, uint32_t version, uint32_t id)
+{
+    wl_resource *resource = wl_resource_create(client, &nuclear_stats_interface, version, id);
+
+    if (Shell::instance()->isTrusted(client, "nuclear_stats")) {
+        wl_resource_set_implementation(resource, &s_implementation, this, nullptr);
+        ObjectStats::countResource(resource, &nuclear_stats_interface);
+        for (auto &p: s_providers) {
+            nuclear_stats_send_category(resource, p.first.c_str());
+        }
+        return;
+    }
+
+    wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "permission to bind nuclear_stats denied");
+    wl_resource_destroy(resource);
+}
+
+void StatsInterface::query(wl_client *client, wl_resource *resource, const char *category)
+{
+    class Sink : public StatsSink
+    {
+    public:
+        Sink(wl_resource *r) : resource(r) {}
+        void entry(const std::string &object, const char *key, int32_t value) override
+        {
+            nuclear_stats_send_entry(resource, object.c_str(), key, value);
+        }
+        wl_resource *resource;
+    };
+
+    auto it = s_providers.find(category);
+    if (it != s_providers.end()) {
+        Sink sink(resource);
+        it->second(&sink);
+    }
+    nuclear_stats_send_done(resource, category);
+}
+
+const struct nuclear_stats_interface StatsInterface::s_implementation = {
+    wrapInterface(&StatsInterface::query)
+};
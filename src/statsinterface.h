@@ -0,0 +1,57 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATSINTERFACE_H
+#define STATSINTERFACE_H
+
+#include <string>
+#include <functional>
+
+#include <wayland-server.h>
+
+#include "interface.h"
+
+class StatsSink
+{
+public:
+    virtual ~StatsSink() {}
+    virtual void entry(const std::string &object, const char *key, int32_t value) = 0;
+};
+
+/*
+ * Sends to trusted clients the statistics gathered by the providers. A
+ * provider is called every time its category is queried and writes the
+ * current values to the sink.
+ */
+class StatsInterface : public Interface
+{
+public:
+    typedef std::function<void (StatsSink *sink)> Provider;
+
+    StatsInterface();
+
+    static void addProvider(const std::string &category, const Provider &provider);
+    static void removeProvider(const std::string &category);
+
+private:
+    void bind(wl_client *client, uint32_t version, uint32_t id);
+    void query(wl_client *client, wl_resource *resource, const char *category);
+
+    static const struct nuclear_stats_interface s_implementation;
+};
+
+#endif
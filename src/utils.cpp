@@ -16,13 +16,222 @@
  */
 
 
+#include <time.h>
+
 #include "utils.h"
-#include "shell.h"
+
+static TimerWheel *s_wheel = nullptr;
+
+static uint64_t monotonicTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void TimerWheel::init(wl_event_loop *loop, Clock clock)
+{
+    if (!s_wheel) {
+        s_wheel = new TimerWheel(loop, clock ? clock : monotonicTime);
+    }
+}
+
+void TimerWheel::cleanup()
+{
+    // The wheel itself stays, the timers still being destroyed use it.
+    if (s_wheel && s_wheel->m_source) {
+        wl_event_source_remove(s_wheel->m_source);
+        s_wheel->m_source = nullptr;
+    }
+}
+
+TimerWheel *TimerWheel::instance()
+{
+    return s_wheel;
+}
+
+TimerWheel::TimerWheel(wl_event_loop *loop, Clock clock)
+          : m_clock(clock)
+          , m_current(clock())
+          , m_count(0)
+          , m_armed(0)
+{
+    // The source is kept for the whole life of the wheel, so that starting
+    // and stopping timers does not create and remove timerfds.
+    m_source = wl_event_loop_add_timer(loop, [](void *data) {
+        static_cast<TimerWheel *>(data)->dispatch();
+        return 1;
+    }, this);
+    for (int l = 0; l < NumLevels; ++l) {
+        for (int i = 0; i < LevelSize; ++i) {
+            wl_list_init(&m_slots[l][i]);
+        }
+    }
+    wl_list_init(&m_overflow);
+}
+
+uint64_t TimerWheel::now() const
+{
+    return m_clock();
+}
+
+void TimerWheel::add(Timer *t)
+{
+    if (m_count == 0) {
+        // Nothing is pending, so there is nothing to expire on the way.
+        m_current = now();
+    }
+    t->m_expire = now() + (t->m_interval > 0 ? t->m_interval : 1);
+    insert(t);
+    ++m_count;
+    // The timer set to expire earlier wakes up the wheel, which then arms
+    // itself for the next thing to do, so only an earlier expiry needs it.
+    if (!m_armed || t->m_expire < m_armed) {
+        arm();
+    }
+}
+
+void TimerWheel::remove(Timer *t)
+{
+    wl_list_remove(&t->m_link);
+    wl_list_init(&t->m_link);
+    // The source is left armed, waking up for nothing costs less than
+    // disarming it and arming it again if another timer starts.
+    --m_count;
+}
+
+void TimerWheel::insert(Timer *t)
+{
+    uint64_t expire = t->m_expire > m_current ? t->m_expire : m_current + 1;
+    for (int l = 0; l < NumLevels; ++l) {
+        int shift = (l + 1) * LevelBits;
+        if ((expire >> shift) == (m_current >> shift)) {
+            int slot = (expire >> (l * LevelBits)) & LevelMask;
+            wl_list_insert(m_slots[l][slot].prev, &t->m_link);
+            return;
+        }
+    }
+    wl_list_insert(m_overflow.prev, &t->m_link);
+}
+
+void TimerWheel::cascade(int level)
+{
+    int slot = (m_current >> (level * LevelBits)) & LevelMask;
+    wl_list list;
+    wl_list_init(&list);
+    wl_list_insert_list(&list, &m_slots[level][slot]);
+    wl_list_init(&m_slots[level][slot]);
+
+    Timer *t, *tmp;
+    wl_list_for_each_safe(t, tmp, &list, m_link) {
+        insert(t);
+    }
+}
+
+void TimerWheel::advance(uint64_t to)
+{
+    // Jump straight to the next slot which has something to expire or to
+    // cascade, skipping the empty milliseconds in between.
+    while (m_current < to) {
+        uint64_t next = nextEvent();
+        if (!next || next > to) {
+            m_current = to;
+            return;
+        }
+        m_current = next;
+
+        // Going from the top down, timers moved from a level may land in the
+        // slot of the level below which starts now.
+        if ((m_current & ((1ull << (NumLevels * LevelBits)) - 1)) == 0) {
+            wl_list list;
+            wl_list_init(&list);
+            wl_list_insert_list(&list, &m_overflow);
+            wl_list_init(&m_overflow);
+            Timer *t, *tmp;
+            wl_list_for_each_safe(t, tmp, &list, m_link) {
+                insert(t);
+            }
+        }
+        for (int l = NumLevels - 1; l > 0; --l) {
+            if ((m_current & ((1ull << (l * LevelBits)) - 1)) == 0) {
+                cascade(l);
+            }
+        }
+
+        wl_list *slot = &m_slots[0][m_current & LevelMask];
+        if (wl_list_empty(slot)) {
+            // Only a cascade was due.
+            continue;
+        }
+
+        wl_list expired;
+        wl_list_init(&expired);
+        wl_list_insert_list(&expired, slot);
+        wl_list_init(slot);
+
+        // The handlers may start and stop any timer, including the expired
+        // ones which are yet to be triggered.
+        while (!wl_list_empty(&expired)) {
+            Timer *t = container_of(expired.next, Timer, m_link);
+            remove(t);
+            t->m_state = Timer::State::Triggered;
+            t->triggered();
+        }
+    }
+}
+
+void TimerWheel::dispatch()
+{
+    m_armed = 0;
+    advance(now());
+    if (m_count > 0) {
+        arm();
+    }
+}
+
+uint64_t TimerWheel::nextEvent() const
+{
+    // Find the first time something has to be done: a level 0 slot to expire
+    // or a higher level slot to cascade. The timers are always in slots after
+    // the current one, and the lowest non empty level always comes first.
+    // Returns 0 when nothing is pending.
+    uint64_t next = 0;
+    for (int l = 0; l < NumLevels && !next; ++l) {
+        int shift = l * LevelBits;
+        int current = (m_current >> shift) & LevelMask;
+        for (int i = current + 1; i < LevelSize; ++i) {
+            if (!wl_list_empty(&m_slots[l][i])) {
+                next = ((m_current >> shift) + (i - current)) << shift;
+                break;
+            }
+        }
+    }
+    if (!next && !wl_list_empty(&m_overflow)) {
+        int shift = NumLevels * LevelBits;
+        next = ((m_current >> shift) + 1) << shift;
+    }
+    return next;
+}
+
+void TimerWheel::arm()
+{
+    uint64_t next = nextEvent();
+    if (!next || !m_source) {
+        return;
+    }
+
+    m_armed = next;
+    int64_t delay = (int64_t)(next - now());
+    wl_event_source_timer_update(m_source, delay > 0 ? delay : 1);
+}
+
 
 Timer::Timer(int interval)
      : m_interval(interval)
-     , m_source(nullptr)
+     , m_state(State::Stopped)
+     , m_expire(0)
 {
+    wl_list_init(&m_link);
 }
 
 Timer::~Timer()
@@ -30,24 +239,28 @@ Timer::~Timer()
     stop();
 }
 
+void Timer::setInterval(int interval)
+{
+    m_interval = interval;
+}
+
 void Timer::start()
 {
-    if (!m_source) {
-        wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
-        m_source = wl_event_loop_add_timer(loop, [](void *data) { static_cast<Timer *>(data)->triggered(); return 1; }, this);
-        wl_event_source_timer_update(m_source, m_interval);
+    if (m_state == State::Stopped && TimerWheel::instance()) {
+        m_state = State::Pending;
+        TimerWheel::instance()->add(this);
     }
 }
 
 void Timer::stop()
 {
-    if (m_source) {
-        wl_event_source_remove(m_source);
-        m_source = nullptr;
+    if (m_state == State::Pending) {
+        TimerWheel::instance()->remove(this);
     }
+    m_state = State::Stopped;
 }
 
 bool Timer::isRunning() const
 {
-    return m_source != nullptr;
+    return m_state != State::Stopped;
 }
@@ -48,12 +48,13 @@ public:
 typedef Vector2D<int> IVector2D;
 typedef Rect2D<int> IRect2D;
 
-class WlListener {
+class WlListener : public Counted<WlListener> {
 public:
     WlListener() {
         signal = new Signal<void *>;
         m_listener.parent = this;
         m_listener.listener.notify = notify;
+        wl_list_init(&m_listener.listener.link);
     }
     ~WlListener() { signal->flush(); wl_list_remove(&m_listener.listener.link); }
 
@@ -102,11 +103,20 @@ constexpr static auto createWrapper(R (T::*func)(Args...)) -> Wrapper<R, T, Args
     return Wrapper<R, T, Args...>();
 }
 
+/*
+ * A one shot timer. All the timers are kept in a single hierarchical timer
+ * wheel driven by one event loop timer, so starting and stopping them is cheap.
+ * After it is triggered the timer counts as running until stop() is called.
+ */
 class Timer {
 public:
     Timer(int interval);
     ~Timer();
 
+    /*
+     * The new interval is used the next time the timer is started.
+     */
+    void setInterval(int interval);
     void start();
     void stop();
     bool isRunning() const;
@@ -114,7 +124,69 @@ public:
     Signal<> triggered;
 
 private:
+    enum class State {
+        Stopped,
+        Pending,
+        Triggered
+    };
+
     int m_interval;
+    State m_state;
+    uint64_t m_expire;
+    wl_list m_link;
+
+    friend class TimerWheel;
+};
+
+/*
+ * The wheel has four levels of 64 slots each, with a tick of 1 ms. A timer is
+ * put in the lowest level whose current block contains its expiry time, and
+ * it is moved down a level when the wheel reaches the start of its slot.
+ * Timers further than 2^24 ms (about 4.6 hours) away wait in an overflow list
+ * which is looked at every time the top level wraps around.
+ * It is driven by one event loop timer, which is armed again only when a
+ * timer is started which expires before the time it is armed for.
+ */
+class TimerWheel
+{
+public:
+    typedef uint64_t (*Clock)();
+
+    /*
+     * Creates the wheel the timers use, with a timer source on loop. The
+     * clock returns the time in ms, by default of CLOCK_MONOTONIC.
+     */
+    static void init(wl_event_loop *loop, Clock clock = nullptr);
+    /*
+     * Removes the timer source, nothing is triggered after this.
+     */
+    static void cleanup();
+    static TimerWheel *instance();
+
+    void add(Timer *t);
+    void remove(Timer *t);
+
+private:
+    static const int LevelBits = 6;
+    static const int LevelSize = 1 << LevelBits;
+    static const int LevelMask = LevelSize - 1;
+    static const int NumLevels = 4;
+
+    TimerWheel(wl_event_loop *loop, Clock clock);
+    uint64_t now() const;
+    void insert(Timer *t);
+    void advance(uint64_t to);
+    void cascade(int level);
+    uint64_t nextEvent() const;
+    void arm();
+    void dispatch();
+
+    Clock m_clock;
+    uint64_t m_current;
+    int m_count;
+    uint64_t m_armed;
+    wl_list m_slots[NumLevels][LevelSize];
+    wl_list m_overflow;
     wl_event_source *m_source;
 };
 
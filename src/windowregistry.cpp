@@ -0,0 +1,370 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <algorithm>
+
+#include <weston/compositor.h>
+
+#include "windowregistry.h"
+#include "shell.h"
+#include "shellsurface.h"
+#include "workspace.h"
+#include "wayland-window-registry-server-protocol.h"
+
+static const uint32_t TABLE_MAGIC = 0x5452574e;
+static const uint32_t TABLE_VERSION = 1;
+
+struct TableHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence;
+    uint32_t generation;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t stringsOffset;
+    uint32_t stringsSize;
+};
+
+struct TableRecord {
+    uint32_t id;
+    uint32_t titleOffset;
+    uint32_t titleLength;
+    uint32_t state;
+    int32_t workspace;
+    int32_t output;
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+class WindowRegistry::Window : public Interface
+{
+public:
+    Window(WindowRegistry *registry, uint32_t id)
+        : Interface()
+        , m_registry(registry)
+        , m_id(id)
+    {
+    }
+    ~Window()
+    {
+        if (m_registry) {
+            m_registry->removeWindow(this);
+        }
+    }
+
+    ShellSurface *shsurf() { return static_cast<ShellSurface *>(object()); }
+    bool isListed()
+    {
+        ShellSurface *s = shsurf();
+        return s->isMapped() && s->type() == ShellSurface::Type::TopLevel && !s->isTransient();
+    }
+    void changed()
+    {
+        if (m_registry) {
+            m_registry->scheduleUpdate();
+        }
+    }
+    void changedSurface(ShellSurface *) { changed(); }
+
+    WindowRegistry *m_registry;
+    uint32_t m_id;
+
+protected:
+    virtual void added() override
+    {
+        ShellSurface *s = shsurf();
+        s->typeChangedSignal.connect(this, &Window::changed);
+        s->titleChangedSignal.connect(this, &Window::changed);
+        s->activeChangedSignal.connect(this, &Window::changed);
+        s->mappedSignal.connect(this, &Window::changed);
+        s->unmappedSignal.connect(this, &Window::changed);
+        s->geometryChangedSignal.connect(this, &Window::changed);
+        s->workspaceChangedSignal.connect(this, &Window::changed);
+        s->minimizedSignal.connect(this, &Window::changedSurface);
+        s->unminimizedSignal.connect(this, &Window::changedSurface);
+        s->moveEndSignal.connect(this, &Window::changedSurface);
+    }
+};
+
+WindowRegistry::WindowRegistry()
+              : Interface()
+              , m_idleSource(nullptr)
+              , m_fd(-1)
+              , m_readOnlyFd(-1)
+              , m_data(nullptr)
+              , m_size(0)
+              , m_capacity(0)
+              , m_stringsSize(0)
+              , m_generation(0)
+              , m_nextId(1)
+{
+    wl_global_create(Shell::instance()->compositor()->wl_display, &nuclear_window_registry_interface, 1, this,
+                     [](wl_client *client, void *data, uint32_t version, uint32_t id) {
+                         static_cast<WindowRegistry *>(data)->bind(client, version, id);
+                     });
+
+    resize(32, 4096);
+}
+
+WindowRegistry::~WindowRegistry()
+{
+    if (m_idleSource) {
+        wl_event_source_remove(m_idleSource);
+    }
+    for (Window *w: m_windows) {
+        w->m_registry = nullptr;
+    }
+    for (wl_resource *r: m_resources) {
+        wl_resource_set_destructor(r, nullptr);
+    }
+    releaseTable();
+}
+
+void WindowRegistry::addSurface(ShellSurface *surface)
+{
+    Window *w = new Window(this, m_nextId++);
+    m_windows.push_back(w);
+    surface->addInterface(w);
+}
+
+void WindowRegistry::removeWindow(Window *w)
+{
+    m_windows.remove(w);
+    scheduleUpdate();
+}
+
+void WindowRegistry::bind(wl_client *client, uint32_t version, uint32_t id)
+{
+    wl_resource *resource = wl_resource_create(client, &nuclear_window_registry_interface, version, id);
+
+    if (!Shell::instance()->isTrusted(client, "nuclear_window_registry")) {
+        wl_resource_post_error(resource, WL_DISPLAY_ERROR_INVALID_OBJECT, "permission to bind nuclear_window_registry denied");
+        wl_resource_destroy(resource);
+        return;
+    }
+
+    wl_resource_set_implementation(resource, nullptr, this, [](wl_resource *res) {
+        static_cast<WindowRegistry *>(wl_resource_get_user_data(res))->unbind(res);
+    });
+    m_resources.push_back(resource);
+
+    if (m_readOnlyFd >= 0) {
+        nuclear_window_registry_send_table(resource, m_readOnlyFd, m_size);
+        nuclear_window_registry_send_generation_changed(resource, m_generation);
+    }
+}
+
+bool WindowRegistry::isBound(wl_client *client) const
+{
+    for (wl_resource *r: m_resources) {
+        if (wl_resource_get_client(r) == client) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WindowRegistry::unbind(wl_resource *resource)
+{
+    m_resources.remove(resource);
+}
+
+void WindowRegistry::scheduleUpdate()
+{
+    if (m_idleSource) {
+        return;
+    }
+
+    wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+    m_idleSource = wl_event_loop_add_idle(loop, [](void *data) {
+        WindowRegistry *r = static_cast<WindowRegistry *>(data);
+        r->m_idleSource = nullptr;
+        r->update();
+    }, this);
+}
+
+void WindowRegistry::releaseTable()
+{
+    if (m_data) {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    if (m_readOnlyFd >= 0) {
+        close(m_readOnlyFd);
+        m_readOnlyFd = -1;
+    }
+    m_size = 0;
+}
+
+bool WindowRegistry::resize(uint32_t capacity, uint32_t stringsSize)
+{
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    if (!dir) {
+        weston_log("nuclear: XDG_RUNTIME_DIR is not set, cannot create the window registry.\n");
+        return false;
+    }
+
+    std::string path = std::string(dir) + "/nuclear-windows-XXXXXX";
+    int fd = mkostemp(&path[0], O_CLOEXEC);
+    if (fd < 0) {
+        weston_log("nuclear: cannot create the window registry file: %s\n", strerror(errno));
+        return false;
+    }
+    // The clients get a read only descriptor, they must not be able to write the table.
+    int roFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    unlink(path.c_str());
+
+    size_t size = sizeof(TableHeader) + capacity * sizeof(TableRecord) + stringsSize;
+    void *data = MAP_FAILED;
+    if (roFd >= 0 && ftruncate(fd, size) == 0) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED) {
+        weston_log("nuclear: cannot map the window registry file: %s\n", strerror(errno));
+        if (roFd >= 0) {
+            close(roFd);
+        }
+        close(fd);
+        return false;
+    }
+
+    releaseTable();
+    m_fd = fd;
+    m_readOnlyFd = roFd;
+    m_data = data;
+    m_size = size;
+    m_capacity = capacity;
+    m_stringsSize = stringsSize;
+
+    TableHeader *header = static_cast<TableHeader *>(m_data);
+    header->magic = TABLE_MAGIC;
+    header->version = TABLE_VERSION;
+    header->sequence = 0;
+    header->generation = m_generation;
+    header->recordSize = sizeof(TableRecord);
+    header->capacity = m_capacity;
+    header->count = 0;
+    header->stringsOffset = sizeof(TableHeader) + m_capacity * sizeof(TableRecord);
+    header->stringsSize = m_stringsSize;
+
+    for (wl_resource *r: m_resources) {
+        nuclear_window_registry_send_table(r, m_readOnlyFd, m_size);
+    }
+    return true;
+}
+
+void WindowRegistry::update()
+{
+    uint32_t count = 0;
+    uint32_t strings = 0;
+    for (Window *w: m_windows) {
+        if (w->isListed()) {
+            ++count;
+            strings += w->shsurf()->title().size() + 1;
+        }
+    }
+
+    if (count > m_capacity || strings > m_stringsSize) {
+        // The table may not exist, if the first resize failed.
+        uint32_t capacity = std::max(m_capacity, 32u);
+        uint32_t stringsSize = std::max(m_stringsSize, 4096u);
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        while (stringsSize < strings) {
+            stringsSize *= 2;
+        }
+        if (!resize(capacity, stringsSize)) {
+            return;
+        }
+    }
+    if (!m_data) {
+        return;
+    }
+
+    TableHeader *header = static_cast<TableHeader *>(m_data);
+    TableRecord *records = reinterpret_cast<TableRecord *>(header + 1);
+    char *stringsData = static_cast<char *>(m_data) + header->stringsOffset;
+
+    // Make the sequence odd while writing, so that the readers know they must retry.
+    uint32_t seq = header->sequence;
+    __atomic_store_n(&header->sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    uint32_t i = 0;
+    uint32_t offset = 0;
+    for (Window *w: m_windows) {
+        if (!w->isListed()) {
+            continue;
+        }
+
+        ShellSurface *s = w->shsurf();
+        const std::string &title = s->title();
+        TableRecord *rec = &records[i++];
+
+        uint32_t state = 0;
+        if (s->isActive()) {
+            state |= NUCLEAR_WINDOW_REGISTRY_STATE_ACTIVE;
+        }
+        if (s->isMinimized()) {
+            state |= NUCLEAR_WINDOW_REGISTRY_STATE_MINIMIZED;
+        }
+        if (s->isMaximized()) {
+            state |= NUCLEAR_WINDOW_REGISTRY_STATE_MAXIMIZED;
+        }
+        if (s->isFullscreen()) {
+            state |= NUCLEAR_WINDOW_REGISTRY_STATE_FULLSCREEN;
+        }
+
+        rec->id = w->m_id;
+        rec->titleOffset = offset;
+        rec->titleLength = title.size();
+        rec->state = state;
+        rec->workspace = s->workspace() ? s->workspace()->number() : -1;
+        rec->output = s->output() ? (int32_t)s->output()->id : -1;
+        rec->x = s->x();
+        rec->y = s->y();
+        rec->width = s->width();
+        rec->height = s->height();
+
+        memcpy(stringsData + offset, title.c_str(), title.size() + 1);
+        offset += title.size() + 1;
+    }
+    header->count = count;
+    header->generation = ++m_generation;
+
+    __atomic_store_n(&header->sequence, seq + 2, __ATOMIC_RELEASE);
+
+    for (wl_resource *r: m_resources) {
+        nuclear_window_registry_send_generation_changed(r, m_generation);
+    }
+}
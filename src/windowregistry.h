@@ -0,0 +1,72 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WINDOWREGISTRY_H
+#define WINDOWREGISTRY_H
+
+#include <list>
+
+#include <wayland-server.h>
+
+#include "interface.h"
+
+class ShellSurface;
+
+/*
+ * Publishes the list of the toplevel windows in a memory mapped file shared
+ * with the trusted clients, so that taskbars and switchers can read it without
+ * a roundtrip per window. The file is only rewritten once per event loop
+ * iteration, no matter how many windows changed in the meantime.
+ */
+class WindowRegistry : public Interface
+{
+public:
+    WindowRegistry();
+    ~WindowRegistry();
+
+    void addSurface(ShellSurface *surface);
+    /*
+     * Whether the client reads the table, which replaces the per window
+     * title and state events of desktop_shell for it.
+     */
+    bool isBound(wl_client *client) const;
+
+private:
+    class Window;
+
+    void bind(wl_client *client, uint32_t version, uint32_t id);
+    void unbind(wl_resource *resource);
+    void removeWindow(Window *w);
+    void scheduleUpdate();
+    void update();
+    bool resize(uint32_t capacity, uint32_t stringsSize);
+    void releaseTable();
+
+    std::list<Window *> m_windows;
+    std::list<wl_resource *> m_resources;
+    wl_event_source *m_idleSource;
+    int m_fd;
+    int m_readOnlyFd;
+    void *m_data;
+    size_t m_size;
+    uint32_t m_capacity;
+    uint32_t m_stringsSize;
+    uint32_t m_generation;
+    uint32_t m_nextId;
+};
+
+#endif
@@ -92,9 +92,9 @@ void WlShell::pointerFocus(ShellSeat *, weston_pointer *pointer)
 
     if (!wlss->isResponsive()) {
         surfaceResponsivenessChangedSignal(shsurf, false);
-    } else {
-        uint32_t serial = wl_display_next_serial(Shell::compositor()->wl_display);
-        wlss->ping(serial);
+    }
+    if (wlss->resource()) {
+        ResponsivenessMonitor::instance()->interaction(wl_resource_get_client(wlss->resource()));
     }
 }
 
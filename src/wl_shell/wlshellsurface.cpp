@@ -19,15 +19,9 @@
 #include "shell.h"
 #include "shellsurface.h"
 
-static const int ping_timeout = 200;
-
-
 WlShellSurface::WlShellSurface(WlShell *ws)
               : m_wlShell(ws)
-              , m_pingTimer(ping_timeout)
-              , m_unresponsive(false)
 {
-    m_pingTimer.triggered.connect(this, &WlShellSurface::pingTimeout);
 }
 
 WlShellSurface::~WlShellSurface()
@@ -44,6 +38,7 @@ void WlShellSurface::init(wl_client *client, uint32_t id)
     wl_resource_set_implementation(m_resource, &s_shellSurfaceImplementation, this, [](wl_resource *resource) { static_cast<WlShellSurface *>(wl_resource_get_user_data(resource))->resourceDestroyed(); });
 
     shsurf()->popupDoneSignal.connect(this, &WlShellSurface::popupDone);
+    watch(client);
 }
 
 ShellSurface *WlShellSurface::shsurf()
@@ -57,30 +52,16 @@ void WlShellSurface::resourceDestroyed()
     object()->destroy();
 }
 
-void WlShellSurface::ping(uint32_t serial)
+void WlShellSurface::sendPing(uint32_t serial)
 {
-    if (!m_resource || !wl_resource_get_client(m_resource))
-        return;
-
-    if (!m_pingTimer.isRunning()) {
-        m_pingTimer.start();
-        m_pingSerial = serial;
-
+    if (m_resource) {
         wl_shell_surface_send_ping(m_resource, serial);
     }
 }
 
-bool WlShellSurface::isResponsive() const
-{
-    return !m_unresponsive;
-}
-
-void WlShellSurface::pingTimeout()
+void WlShellSurface::responsivenessChanged()
 {
-    if (!m_unresponsive) {
-        m_unresponsive = true;
-        responsivenessChangedSignal(this);
-    }
+    responsivenessChangedSignal(this);
 }
 
 void WlShellSurface::popupDone()
@@ -90,17 +71,7 @@ void WlShellSurface::popupDone()
 
 void WlShellSurface::pong(wl_client *client, wl_resource *resource, uint32_t serial)
 {
-    if (!m_pingTimer.isRunning())
-        /* Just ignore unsolicited pong. */
-        return;
-
-    if (m_pingSerial == serial) {
-        m_pingTimer.stop();
-        if (m_unresponsive) {
-            m_unresponsive = false;
-            responsivenessChangedSignal(this);
-        }
-    }
+    handlePong(serial);
 }
 
 void WlShellSurface::move(wl_client *client, wl_resource *resource, wl_resource *seat_resource, uint32_t serial)
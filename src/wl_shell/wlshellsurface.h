@@ -23,6 +23,7 @@
 #include "interface.h"
 #include "shellsignal.h"
 #include "utils.h"
+#include "responsivenessmonitor.h"
 
 struct wl_resource;
 struct wl_client;
@@ -31,7 +32,7 @@ struct wl_event_source;
 class WlShell;
 class ShellSurface;
 
-class WlShellSurface : public Interface
+class WlShellSurface : public Interface, public ResponsivenessMonitor::Pinger
 {
 public:
     WlShellSurface(WlShell *wlShell);
@@ -41,8 +42,6 @@ public:
     inline wl_resource *resource() const { return m_resource; }
 
     void init(wl_client *client, uint32_t id);
-    void ping(uint32_t serial);
-    bool isResponsive() const;
 
     Signal<WlShellSurface *> responsivenessChangedSignal;
 
@@ -59,16 +58,13 @@ private:
     void setClass(wl_client *client, wl_resource *resource, const char *className);
 
     void resourceDestroyed();
-    void pingTimeout();
     void popupDone();
+    void sendPing(uint32_t serial) override;
+    void responsivenessChanged() override;
 
     WlShell *m_wlShell;
     wl_resource *m_resource;
 
-    Timer m_pingTimer;
-    uint32_t m_pingSerial;
-    bool m_unresponsive;
-
     static const struct wl_shell_surface_interface s_shellSurfaceImplementation;
 };
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <wayland-server.h>
+
+#include "workerpool.h"
+#include "shell.h"
+
+static const unsigned MaxThreads = 4;
+
+WorkerPool *WorkerPool::s_instance = nullptr;
+
+WorkerPool *WorkerPool::instance()
+{
+    if (!s_instance) {
+        s_instance = new WorkerPool;
+    }
+    return s_instance;
+}
+
+void WorkerPool::cleanup()
+{
+    delete s_instance;
+    s_instance = nullptr;
+}
+
+WorkerPool::WorkerPool()
+          : m_quit(false)
+          , m_eventFd(-1)
+          , m_source(nullptr)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_condition.notify_all();
+    for (std::thread &t: m_threads) {
+        t.join();
+    }
+
+    if (m_source) {
+        wl_event_source_remove(m_source);
+    }
+    if (m_eventFd >= 0) {
+        close(m_eventFd);
+    }
+}
+
+void WorkerPool::start()
+{
+    m_eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    wl_event_loop *loop = wl_display_get_event_loop(Shell::compositor()->wl_display);
+    m_source = wl_event_loop_add_fd(loop, m_eventFd, WL_EVENT_READABLE, [](int fd, uint32_t mask, void *data) {
+        uint64_t v;
+        while (read(fd, &v, sizeof(v)) > 0) {
+        }
+        static_cast<WorkerPool *>(data)->dispatchDone();
+        return 1;
+    }, this);
+
+    unsigned n = std::thread::hardware_concurrency();
+    n = n < 1 ? 1 : (n > MaxThreads ? MaxThreads : n);
+    for (unsigned i = 0; i < n; ++i) {
+        m_threads.push_back(std::thread(&WorkerPool::thread, this));
+    }
+}
+
+void WorkerPool::run(const std::function<void ()> &work, const std::function<void ()> &done)
+{
+    if (m_threads.empty()) {
+        start();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({ work, done });
+    }
+    m_condition.notify_one();
+}
+
+void WorkerPool::dispatchDone()
+{
+    std::list<Task> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        done.swap(m_done);
+    }
+
+    for (Task &t: done) {
+        if (t.done) {
+            t.done();
+        }
+    }
+}
+
+void WorkerPool::thread()
+{
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+            // Finish the queue before quitting, the session and the settings
+            // are saved at exit.
+            if (m_queue.empty()) {
+                return;
+            }
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        task.work();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.push_back(std::move(task));
+        }
+        uint64_t one = 1;
+        if (write(m_eventFd, &one, sizeof(one)) < 0) {
+            // The counter can only overflow after 2^64 writes, nothing to do here.
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct wl_event_source;
+
+/*
+ * A few threads for the work which would block the main loop, like disk
+ * access or image encoding. The work function runs on one of the threads,
+ * so it must not touch the compositor or the shell, and the done function
+ * is then called back on the main loop with its result. Tasks may run in
+ * any order and at the same time. At exit the queued tasks are still run,
+ * but their done functions are not called anymore.
+ */
+class WorkerPool
+{
+public:
+    static WorkerPool *instance();
+    static void cleanup();
+
+    void run(const std::function<void ()> &work, const std::function<void ()> &done = nullptr);
+
+    template<class T>
+    void run(const std::function<T ()> &work, const std::function<void (T)> &done)
+    {
+        std::shared_ptr<T> result = std::make_shared<T>();
+        run([work, result]() { *result = work(); }, [done, result]() { done(std::move(*result)); });
+    }
+
+private:
+    struct Task {
+        std::function<void ()> work;
+        std::function<void ()> done;
+    };
+
+    WorkerPool();
+    ~WorkerPool();
+    void start();
+    void thread();
+    void dispatchDone();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::list<Task> m_queue;
+    std::list<Task> m_done;
+    bool m_quit;
+    int m_eventFd;
+    wl_event_source *m_source;
+
+    static WorkerPool *s_instance;
+};
+
+#endif
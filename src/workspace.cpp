@@ -58,8 +58,14 @@ Workspace::~Workspace()
 
     remove();
     destroyedSignal(this);
+    // The background views are in m_backgroundLayer, they go with it.
     for (auto &i: m_outputs) {
-        delete i.second;
+        Output *out = i.second;
+        if (out->background) {
+            out->backgroundDestroy.reset();
+            weston_view_destroy(out->background);
+        }
+        delete out;
     }
     weston_surface_destroy(m_rootSurface->surface);
 }
@@ -70,6 +76,8 @@ void Workspace::createBackgroundView(weston_surface *bkg, weston_output *output)
     if (m_outputs.count(output)) {
         out = m_outputs.at(output);
         if (out->background && out->background->surface != bkg) {
+            // Not through backgroundDestroyed(), which would delete out.
+            out->backgroundDestroy.reset();
             weston_view_destroy(out->background);
             out->background = nullptr;
         }
@@ -112,7 +120,10 @@ void Workspace::addSurface(ShellSurface *surface)
         weston_view_set_transform_parent(surface->view(), m_rootSurface);
     }
     m_layer.addSurface(surface);
-    surface->m_workspace = this;
+    if (surface->m_workspace != this) {
+        surface->m_workspace = this;
+        surface->workspaceChangedSignal();
+    }
 }
 
 void Workspace::removeSurface(ShellSurface *surface)
@@ -185,6 +196,7 @@ void Workspace::insert(struct weston_layer *layer)
 void Workspace::remove()
 {
     m_layer.remove();
+    m_backgroundLayer.remove();
 }
 
 void Workspace::setActive(bool active)
@@ -129,9 +129,9 @@ void XdgShell::pointerFocus(ShellSeat *, weston_pointer *pointer)
 
     if (!xdg->isResponsive()) {
         surfaceResponsivenessChangedSignal(shsurf, false);
-    } else {
-        uint32_t serial = wl_display_next_serial(Shell::compositor()->wl_display);
-        xdg->ping(serial);
+    }
+    if (xdg->resource()) {
+        ResponsivenessMonitor::instance()->interaction(wl_resource_get_client(xdg->resource()));
     }
 }
 
@@ -21,15 +21,10 @@
 #include "shell.h"
 #include "wayland-xdg-shell-server-protocol.h"
 
-static const int ping_timeout = 200;
-
 XdgBaseSurface::XdgBaseSurface(XdgShell *ws)
           : m_resource(nullptr)
           , m_xdgShell(ws)
-          , m_pingTimer(ping_timeout)
-          , m_unresponsive(false)
 {
-    m_pingTimer.triggered.connect(this, &XdgBaseSurface::pingTimeout);
 }
 
 XdgBaseSurface::~XdgBaseSurface()
@@ -51,44 +46,14 @@ ShellSurface *XdgBaseSurface::shsurf()
     return static_cast<ShellSurface *>(object());
 }
 
-bool XdgBaseSurface::isResponsive() const
-{
-    return !m_unresponsive;
-}
-
-void XdgBaseSurface::ping(uint32_t serial)
-{
-    if (!m_resource || !wl_resource_get_client(m_resource))
-        return;
-
-    if (!m_pingTimer.isRunning()) {
-        m_pingTimer.start();
-        m_pingSerial = serial;
-        wl_shell_surface_send_ping(m_resource, serial);
-    }
-}
-
 void XdgBaseSurface::pong(uint32_t serial)
 {
-    if (!m_pingTimer.isRunning())
-        /* Just ignore unsolicited pong. */
-        return;
-
-    if (m_pingSerial == serial) {
-        m_pingTimer.stop();
-        if (m_unresponsive) {
-            m_unresponsive = false;
-            responsivenessChangedSignal(this);
-        }
-    }
+    handlePong(serial);
 }
 
-void XdgBaseSurface::pingTimeout()
+void XdgBaseSurface::responsivenessChanged()
 {
-    if (!m_unresponsive) {
-        m_unresponsive = true;
-        responsivenessChangedSignal(this);
-    }
+    responsivenessChangedSignal(this);
 }
 
 
@@ -104,11 +69,14 @@ void XdgSurface::init(wl_client *client, uint32_t id)
 {
     m_resource = wl_resource_create(client, &xdg_surface_interface, 1, id);
     wl_resource_set_implementation(m_resource, &s_implementation, this, [](wl_resource *resource) { static_cast<XdgSurface *>(wl_resource_get_user_data(resource))->resourceDestroyed(); });
+    watch(client);
 }
 
 void XdgSurface::sendPing(uint32_t serial)
 {
-    xdg_surface_send_ping(m_resource, serial);
+    if (m_resource) {
+        xdg_surface_send_ping(m_resource, serial);
+    }
 }
 
 void XdgSurface::gainFocus()
@@ -241,11 +209,14 @@ void XdgPopup::init(wl_client *client, uint32_t id)
     wl_resource_set_implementation(m_resource, &s_implementation, this, [](wl_resource *resource) { static_cast<XdgPopup *>(wl_resource_get_user_data(resource))->resourceDestroyed(); });
 
     shsurf()->popupDoneSignal.connect(this, &XdgPopup::popupDone);
+    watch(client);
 }
 
 void XdgPopup::sendPing(uint32_t serial)
 {
-    xdg_popup_send_ping(m_resource, serial);
+    if (m_resource) {
+        xdg_popup_send_ping(m_resource, serial);
+    }
 }
 
 void XdgPopup::popupDone()
@@ -23,6 +23,7 @@
 #include "interface.h"
 #include "shellsignal.h"
 #include "utils.h"
+#include "responsivenessmonitor.h"
 
 struct wl_resource;
 struct wl_client;
@@ -33,7 +34,7 @@ struct weston_output;
 class XdgShell;
 class ShellSurface;
 
-class XdgBaseSurface : public Interface
+class XdgBaseSurface : public Interface, public ResponsivenessMonitor::Pinger
 {
 public:
     XdgBaseSurface(XdgShell *xdgShell);
@@ -42,30 +43,18 @@ public:
     ShellSurface *shsurf();
     inline wl_resource *resource() const { return m_resource; }
 
-    void ping(uint32_t serial);
-    bool isResponsive() const;
-
     Signal<XdgBaseSurface *> responsivenessChangedSignal;
 
 protected:
-    virtual void sendPing(uint32_t serial) {}
+    void sendPing(uint32_t serial) override {}
+    void responsivenessChanged() override;
     void pong(uint32_t serial);
     void resourceDestroyed();
 
     wl_resource *m_resource;
 
 private:
-    void pingTimeout();
-
-    struct PingTimer {
-        wl_event_source *source;
-        uint32_t serial;
-    };
-
     XdgShell *m_xdgShell;
-    Timer m_pingTimer;
-    uint32_t m_pingSerial;
-    bool m_unresponsive;
 };
 
 class XdgSurface : public XdgBaseSurface
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "animationgovernor.h"
+#include "fake/fakeweston.h"
+#include "test.h"
+
+typedef AnimationGovernor::Profile Profile;
+
+static uint32_t s_msecs = 1000;
+
+// Enough frames for a whole window, plus the first one which only starts
+// the counting.
+static void frames(weston_output *output, uint32_t interval, int count = 31)
+{
+    AnimationGovernor *g = AnimationGovernor::instance();
+    for (int i = 0; i < count; ++i) {
+        s_msecs += interval;
+        FakeWeston::setTime(s_msecs);
+        g->frame(output, s_msecs);
+    }
+}
+
+static void testDegrade(weston_output *output)
+{
+    AnimationGovernor *g = AnimationGovernor::instance();
+    CHECK(g->profile() == Profile::Full);
+
+    // At 60 Hz with the default budget of 150% a frame may take 25 ms.
+    frames(output, 20);
+    CHECK(g->profile() == Profile::Full);
+
+    frames(output, 40);
+    CHECK(g->profile() == Profile::Short);
+    frames(output, 40);
+    CHECK(g->profile() == Profile::NoAlpha);
+    frames(output, 40);
+    CHECK(g->profile() == Profile::Instant);
+}
+
+static void testIgnoredFrames(weston_output *output)
+{
+    AnimationGovernor *g = AnimationGovernor::instance();
+    Profile profile = g->profile();
+
+    // Frames of different animations, and repeated frames, do not count.
+    for (int i = 0; i < 100; ++i) {
+        s_msecs += 300;
+        g->frame(output, s_msecs);
+        g->frame(output, s_msecs);
+    }
+    CHECK(g->profile() == profile);
+}
+
+static void testRecover(weston_output *output)
+{
+    AnimationGovernor *g = AnimationGovernor::instance();
+    CHECK(g->profile() == Profile::Instant);
+
+    // No frames come in the Instant profile, animations are tried again
+    // after a while.
+    FakeWeston::setTime(s_msecs + 1000);
+    g->animationStarted();
+    CHECK(g->profile() == Profile::Instant);
+    FakeWeston::setTime(s_msecs + 2500);
+    g->animationStarted();
+    CHECK(g->profile() == Profile::NoAlpha);
+
+    frames(output, 16);
+    CHECK(g->profile() == Profile::Short);
+    frames(output, 16);
+    CHECK(g->profile() == Profile::Full);
+    frames(output, 16);
+    CHECK(g->profile() == Profile::Full);
+}
+
+static void testRefresh()
+{
+    AnimationGovernor *g = AnimationGovernor::instance();
+    weston_output *output = FakeWeston::createOutput(30000);
+
+    // At 30 Hz the same frames are within the budget.
+    frames(output, 40);
+    frames(output, 40);
+    CHECK(g->profile() == Profile::Full);
+
+    FakeWeston::destroyOutput(output);
+}
+
+static void testDisable(weston_output *output)
+{
+    AnimationGovernor *g = AnimationGovernor::instance();
+    frames(output, 40);
+    CHECK(g->profile() == Profile::Short);
+
+    int logs = FakeWeston::logCount();
+    g->setEnabled(false);
+    CHECK(g->profile() == Profile::Full);
+    CHECK(FakeWeston::logCount() == logs + 1);
+
+    frames(output, 40);
+    frames(output, 40);
+    CHECK(g->profile() == Profile::Full);
+    g->setEnabled(true);
+}
+
+int main()
+{
+    weston_output *output = FakeWeston::createOutput(60000);
+
+    testDegrade(output);
+    testRecover(output);
+    testIgnoredFrames(output);
+    testRefresh();
+    testDisable(output);
+
+    FakeWeston::destroyOutput(output);
+    return s_failures;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include <vector>
+
+#include "animation.h"
+#include "animationcurve.h"
+#include "springanimation.h"
+#include "fake/fakeweston.h"
+#include "test.h"
+
+static uint32_t s_msecs = 1000;
+
+class Recorder
+{
+public:
+    Recorder(Animation *animation)
+        : done(0)
+    {
+        animation->updateSignal->connect([this](float v) { values.push_back(v); });
+        animation->doneSignal->connect([this]() { ++done; });
+    }
+
+    std::vector<float> values;
+    int done;
+};
+
+// Repaints output at 60 Hz until it has no more animations.
+static int repaintAll(weston_output *output)
+{
+    int frames = 0;
+    while (!wl_list_empty(&output->animation_list) && frames < 1000) {
+        FakeWeston::repaint(output, s_msecs);
+        s_msecs += 16;
+        ++frames;
+    }
+    return frames;
+}
+
+static void testRun(weston_output *output)
+{
+    Animation a;
+    Recorder r(&a);
+    a.setStart(0);
+    a.setTarget(100);
+
+    int repaints = FakeWeston::scheduledRepaints();
+    a.run(output, 160, Animation::Flags::SendDone);
+    CHECK(a.isRunning());
+    CHECK(FakeWeston::scheduledRepaints() > repaints);
+    CHECK(r.values.size() == 1 && r.values[0] == 0);
+
+    // Every frame shows what will be on screen one refresh later, so the
+    // first one already moves, and 160 ms take ten frames.
+    CHECK(repaintAll(output) == 10);
+    CHECK(!a.isRunning());
+    CHECK(r.done == 1);
+    CHECK(r.values.size() == 11);
+    CHECK(r.values[1] == 10);
+    CHECK(r.values.back() == 100);
+    for (size_t i = 1; i < r.values.size(); ++i) {
+        CHECK(r.values[i] > r.values[i - 1]);
+    }
+}
+
+static void testRepeatedFrame(weston_output *output)
+{
+    Animation a;
+    Recorder r(&a);
+    a.setStart(0);
+    a.setTarget(100);
+    a.run(output, 160);
+
+    FakeWeston::repaint(output, s_msecs);
+    FakeWeston::repaint(output, s_msecs + 16);
+    size_t count = r.values.size();
+    // A second repaint for the same vblank does not move it.
+    FakeWeston::repaint(output, s_msecs + 16);
+    CHECK(r.values.size() == count);
+
+    s_msecs += 32;
+    repaintAll(output);
+    // Not run with SendDone.
+    CHECK(r.done == 0);
+    CHECK(r.values.back() == 100);
+}
+
+static void testCurve(weston_output *output)
+{
+    Animation a;
+    Recorder r(&a);
+    a.setStart(0);
+    a.setTarget(100);
+    a.setCurve(InQuadCurve());
+    a.run(output, 160);
+
+    repaintAll(output);
+    // The frames are 16 ms apart, 10% of the duration.
+    CHECK(fabs(r.values[1] - 1) < 0.001);
+    CHECK(fabs(r.values[5] - 25) < 0.001);
+    CHECK(r.values.back() == 100);
+}
+
+static void testFinishAndStop(weston_output *output)
+{
+    Animation a;
+    Recorder r(&a);
+    a.setStart(0);
+    a.setTarget(100);
+
+    a.run(output, 160, Animation::Flags::SendDone);
+    FakeWeston::repaint(output, s_msecs);
+    s_msecs += 16;
+    a.finish();
+    CHECK(!a.isRunning());
+    CHECK(r.values.back() == 100);
+    CHECK(r.done == 1);
+    // Finishing again does nothing.
+    a.finish();
+    CHECK(r.done == 1);
+
+    a.run(output, 160, Animation::Flags::SendDone);
+    size_t count = r.values.size();
+    a.stop();
+    CHECK(!a.isRunning());
+    CHECK(wl_list_empty(&output->animation_list));
+    CHECK(r.values.size() == count);
+    CHECK(r.done == 1);
+}
+
+static void foreignFrame(weston_animation *animation, weston_output *output, uint32_t msecs)
+{
+}
+
+static void testFinishAll(weston_output *output)
+{
+    Animation a, b;
+    Recorder ra(&a), rb(&b);
+    a.setStart(0);
+    a.setTarget(100);
+    b.setStart(0);
+    b.setTarget(50);
+    SpringAnimation spring;
+    int springDone = 0;
+    spring.doneSignal->connect([&springDone]() { ++springDone; });
+    spring.setValue(0);
+    spring.setTarget(1);
+
+    // The animations not made by Animation are left alone.
+    weston_animation foreign;
+    foreign.frame = foreignFrame;
+    foreign.frame_counter = 0;
+    wl_list_insert(&output->animation_list, &foreign.link);
+
+    a.run(output, 160, Animation::Flags::SendDone);
+    spring.run(output);
+    b.run(output, 500);
+    Animation::finishAll(output);
+    CHECK(!a.isRunning());
+    CHECK(!b.isRunning());
+    CHECK(!spring.isRunning());
+    CHECK(spring.value() == 1 && springDone == 1);
+    CHECK(ra.values.back() == 100 && ra.done == 1);
+    CHECK(rb.values.back() == 50 && rb.done == 0);
+    CHECK(wl_list_length(&output->animation_list) == 1);
+
+    wl_list_remove(&foreign.link);
+}
+
+static void testInstant(weston_output *output)
+{
+    Animation a;
+    Recorder r(&a);
+    a.setStart(0);
+    a.setTarget(100);
+
+    Animation::setInstant(true);
+    CHECK(Animation::isInstant());
+    a.run(output, 160, Animation::Flags::SendDone);
+    CHECK(!a.isRunning());
+    CHECK(r.values.size() == 1 && r.values[0] == 100);
+    CHECK(r.done == 1);
+    Animation::setInstant(false);
+    CHECK(!Animation::isInstant());
+
+    // Without an output there is nothing to animate on.
+    a.run(nullptr, 160, Animation::Flags::SendDone);
+    CHECK(!a.isRunning());
+    CHECK(r.done == 2);
+}
+
+int main()
+{
+    weston_output *output = FakeWeston::createOutput(60000);
+
+    testRun(output);
+    testRepeatedFrame(output);
+    testCurve(output);
+    testFinishAndStop(output);
+    testFinishAll(output);
+    testInstant(output);
+
+    FakeWeston::destroyOutput(output);
+    return s_failures;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+#include "layer.h"
+#include "animation.h"
+#include "utils.h"
+#include "fake/fakeweston.h"
+
+/*
+ * Times the hot paths of the shell which can run on the fake compositor.
+ * The numbers are only comparable between runs on the same machine. The
+ * first argument scales the number of iterations.
+ */
+
+static int s_scale = 1;
+
+static uint64_t now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void report(const char *name, int ops, uint64_t start)
+{
+    uint64_t elapsed = now() - start;
+    printf("%-32s %10d ops %12.1f ns/op\n", name, ops, (double)elapsed / ops);
+}
+
+static void benchLayer(int views)
+{
+    Layer layer;
+    std::vector<weston_view *> list;
+    for (int i = 0; i < views; ++i) {
+        list.push_back(FakeWeston::createView(100, 100));
+        layer.addSurface(list.back());
+    }
+
+    int ops = 1000 * s_scale;
+    uint64_t start = now();
+    for (int i = 0; i < ops; ++i) {
+        layer.restack(list[i % views]);
+    }
+    report("layer restack", ops, start);
+
+    ops = 100 * s_scale;
+    int count = 0;
+    start = now();
+    for (int i = 0; i < ops; ++i) {
+        for (weston_view *v: layer) {
+            count += v != nullptr;
+        }
+    }
+    report("layer iterate, per view", ops * views, start);
+
+    for (weston_view *v: list) {
+        weston_surface_destroy(v->surface);
+    }
+}
+
+static void benchTimers(wl_event_loop *loop, int timers)
+{
+    std::vector<Timer *> list;
+    for (int i = 0; i < timers; ++i) {
+        list.push_back(new Timer(1000 + i % 5000));
+    }
+
+    int ops = 100 * s_scale;
+    uint64_t start = now();
+    for (int i = 0; i < ops; ++i) {
+        for (Timer *t: list) {
+            t->start();
+        }
+        for (Timer *t: list) {
+            t->stop();
+        }
+    }
+    report("timer start and stop", ops * timers, start);
+
+    for (Timer *t: list) {
+        t->start();
+    }
+    start = now();
+    uint32_t begin = FakeWeston::time();
+    for (uint32_t t = 0; t <= 6000; t += 16) {
+        FakeWeston::setTime(begin + t);
+        FakeWeston::dispatch(loop);
+    }
+    report("timer expire", timers, start);
+
+    for (Timer *t: list) {
+        delete t;
+    }
+}
+
+static void benchAnimations(int animations)
+{
+    weston_output *output = FakeWeston::createOutput(60000);
+    std::vector<Animation *> list;
+    float sum = 0;
+    for (int i = 0; i < animations; ++i) {
+        Animation *a = new Animation;
+        a->updateSignal->connect([&sum](float v) { sum += v; });
+        a->setStart(0);
+        a->setTarget(1);
+        list.push_back(a);
+    }
+
+    int frames = 0;
+    uint32_t msecs = FakeWeston::time();
+    uint64_t start = now();
+    for (int i = 0; i < s_scale; ++i) {
+        for (Animation *a: list) {
+            a->run(output, 250);
+        }
+        while (!wl_list_empty(&output->animation_list)) {
+            msecs += 16;
+            FakeWeston::repaint(output, msecs);
+            ++frames;
+        }
+    }
+    report("animation frame, per animation", frames * animations, start);
+
+    for (Animation *a: list) {
+        delete a;
+    }
+    FakeWeston::destroyOutput(output);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        s_scale = atoi(argv[1]);
+        if (s_scale < 1) {
+            fprintf(stderr, "usage: %s [scale]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FakeWeston::setTime(1000);
+    wl_event_loop *loop = wl_event_loop_create();
+    TimerWheel::init(loop, []() { return (uint64_t)FakeWeston::time(); });
+
+    benchLayer(1000);
+    benchTimers(loop, 10000);
+    benchAnimations(100);
+
+    TimerWheel::cleanup();
+    wl_event_loop_destroy(loop);
+    return 0;
+}
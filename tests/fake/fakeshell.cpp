@@ -0,0 +1,93 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fakeshell.h"
+#include "shellsurface.h"
+
+Shell *Shell::s_instance = nullptr;
+
+Shell::Shell(struct weston_compositor *ec)
+     : m_child(nullptr)
+     , m_standby(nullptr)
+     , m_compositor(ec)
+     , m_internalClient(nullptr)
+     , m_cursorTheme(nullptr)
+{
+    s_instance = this;
+}
+
+Shell::~Shell()
+{
+    s_instance = nullptr;
+}
+
+void Shell::init()
+{
+}
+
+ShellSurface *Shell::createShellSurface(weston_surface *surface, const weston_shell_client *client)
+{
+    return nullptr;
+}
+
+ShellSurface *Shell::getShellSurface(const struct weston_surface *surf)
+{
+    return nullptr;
+}
+
+struct weston_output *Shell::getDefaultOutput() const
+{
+    if (wl_list_empty(&m_compositor->output_list)) {
+        return nullptr;
+    }
+    return container_of(m_compositor->output_list.next, weston_output, link);
+}
+
+IRect2D Shell::windowsArea(struct weston_output *output) const
+{
+    return IRect2D(output->x, output->y, output->width, output->height);
+}
+
+bool Shell::isTrusted(wl_client *client, const char *interface) const
+{
+    return false;
+}
+
+void Shell::panelConfigure(struct weston_surface *es, int32_t sx, int32_t sy, PanelPosition pos)
+{
+}
+
+void Shell::defaultPointerGrabFocus(weston_pointer_grab *grab)
+{
+}
+
+void Shell::defaultPointerGrabMotion(weston_pointer_grab *grab, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+}
+
+void Shell::defaultPointerGrabButton(weston_pointer_grab *grab, uint32_t time, uint32_t button, uint32_t state)
+{
+}
+
+void Shell::movePointer(weston_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+}
+
+weston_view *ShellSurface::transformParent() const
+{
+    return nullptr;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAKESHELL_H
+#define FAKESHELL_H
+
+#include "shell.h"
+
+/*
+ * A Shell which only has its layers and the compositor, for the classes
+ * which need a Shell around. It does not launch the shell client nor
+ * creates any surface, and no surface is a shell surface for it.
+ */
+class FakeShell : public Shell
+{
+public:
+    FakeShell(weston_compositor *ec) : Shell(ec) {}
+};
+
+#endif
@@ -0,0 +1,463 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <list>
+
+#include <weston/compositor.h>
+
+#include "fakeweston.h"
+
+static uint32_t s_time = 0;
+static int s_logCount = 0;
+static int s_timerSources = 0;
+static int s_timerUpdates = 0;
+static int s_views = 0;
+static int s_damages = 0;
+static int s_scheduledRepaints = 0;
+static weston_compositor *s_compositor = nullptr;
+
+struct wl_event_loop {
+    std::list<wl_event_source *> sources;
+};
+
+struct wl_event_source {
+    wl_event_loop *loop;
+    wl_event_loop_timer_func_t timer;
+    wl_event_loop_idle_func_t idle;
+    void *data;
+    bool armed;
+    uint32_t deadline;
+};
+
+void FakeWeston::setTime(uint32_t msecs)
+{
+    s_time = msecs;
+}
+
+uint32_t FakeWeston::time()
+{
+    return s_time;
+}
+
+int FakeWeston::logCount()
+{
+    return s_logCount;
+}
+
+weston_output *FakeWeston::createOutput(int32_t refresh)
+{
+    weston_output *output = new weston_output;
+    memset(output, 0, sizeof(*output));
+    weston_mode *mode = new weston_mode;
+    memset(mode, 0, sizeof(*mode));
+    mode->refresh = refresh;
+    output->current_mode = mode;
+    output->compositor = compositor();
+    wl_list_init(&output->animation_list);
+    wl_list_insert(output->compositor->output_list.prev, &output->link);
+    return output;
+}
+
+void FakeWeston::destroyOutput(weston_output *output)
+{
+    wl_list_remove(&output->link);
+    delete output->current_mode;
+    delete output;
+}
+
+weston_compositor *FakeWeston::compositor()
+{
+    if (!s_compositor) {
+        s_compositor = new weston_compositor;
+        memset(s_compositor, 0, sizeof(*s_compositor));
+        wl_signal_init(&s_compositor->destroy_signal);
+        wl_list_init(&s_compositor->output_list);
+        wl_list_init(&s_compositor->seat_list);
+        wl_list_init(&s_compositor->layer_list);
+        wl_list_init(&s_compositor->view_list);
+        weston_layer_init(&s_compositor->cursor_layer, &s_compositor->layer_list);
+    }
+    return s_compositor;
+}
+
+weston_view *FakeWeston::createView(int32_t width, int32_t height)
+{
+    weston_surface *surface = weston_surface_create(compositor());
+    surface->width = width;
+    surface->height = height;
+    return weston_view_create(surface);
+}
+
+int FakeWeston::views()
+{
+    return s_views;
+}
+
+int FakeWeston::damages()
+{
+    return s_damages;
+}
+
+int FakeWeston::scheduledRepaints()
+{
+    return s_scheduledRepaints;
+}
+
+void FakeWeston::repaint(weston_output *output, uint32_t msecs)
+{
+    s_time = msecs;
+    weston_animation *animation, *next;
+    wl_list_for_each_safe(animation, next, &output->animation_list, link) {
+        animation->frame_counter++;
+        animation->frame(animation, output, msecs);
+    }
+}
+
+// The log goes to stderr, where ctest shows it for the failed tests.
+int weston_log(const char *fmt, ...)
+{
+    ++s_logCount;
+    va_list ap;
+    va_start(ap, fmt);
+    int l = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return l;
+}
+
+int weston_log_continue(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int l = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return l;
+}
+
+uint32_t weston_compositor_get_time(void)
+{
+    return s_time;
+}
+
+void FakeWeston::dispatch(wl_event_loop *loop)
+{
+    // The sources may be added and removed by the callbacks.
+    std::list<wl_event_source *> sources = loop->sources;
+    for (wl_event_source *s: sources) {
+        if (s->idle) {
+            loop->sources.remove(s);
+            s->idle(s->data);
+            delete s;
+        }
+    }
+    sources = loop->sources;
+    for (wl_event_source *s: sources) {
+        bool alive = false;
+        for (wl_event_source *l: loop->sources) {
+            alive = alive || l == s;
+        }
+        if (alive && s->timer && s->armed && (int32_t)(s_time - s->deadline) >= 0) {
+            s->armed = false;
+            s->timer(s->data);
+        }
+    }
+}
+
+int FakeWeston::timerSources()
+{
+    return s_timerSources;
+}
+
+int FakeWeston::timerUpdates()
+{
+    return s_timerUpdates;
+}
+
+wl_event_loop *wl_event_loop_create(void)
+{
+    return new wl_event_loop;
+}
+
+void wl_event_loop_destroy(wl_event_loop *loop)
+{
+    for (wl_event_source *s: loop->sources) {
+        if (s->timer) {
+            --s_timerSources;
+        }
+        delete s;
+    }
+    delete loop;
+}
+
+wl_event_source *wl_event_loop_add_timer(wl_event_loop *loop, wl_event_loop_timer_func_t func, void *data)
+{
+    wl_event_source *s = new wl_event_source{ loop, func, nullptr, data, false, 0 };
+    loop->sources.push_back(s);
+    ++s_timerSources;
+    return s;
+}
+
+wl_event_source *wl_event_loop_add_idle(wl_event_loop *loop, wl_event_loop_idle_func_t func, void *data)
+{
+    wl_event_source *s = new wl_event_source{ loop, nullptr, func, data, false, 0 };
+    loop->sources.push_back(s);
+    return s;
+}
+
+int wl_event_source_timer_update(wl_event_source *source, int ms_delay)
+{
+    ++s_timerUpdates;
+    source->armed = ms_delay > 0;
+    source->deadline = s_time + ms_delay;
+    return 0;
+}
+
+int wl_event_source_remove(wl_event_source *source)
+{
+    if (source->timer) {
+        --s_timerSources;
+    }
+    source->loop->sources.remove(source);
+    delete source;
+    return 0;
+}
+
+void wl_list_init(wl_list *list)
+{
+    list->prev = list;
+    list->next = list;
+}
+
+void wl_list_insert(wl_list *list, wl_list *elm)
+{
+    elm->prev = list;
+    elm->next = list->next;
+    list->next = elm;
+    elm->next->prev = elm;
+}
+
+void wl_list_remove(wl_list *elm)
+{
+    elm->prev->next = elm->next;
+    elm->next->prev = elm->prev;
+    elm->next = nullptr;
+    elm->prev = nullptr;
+}
+
+int wl_list_length(const wl_list *list)
+{
+    int count = 0;
+    for (wl_list *e = list->next; e != list; e = e->next) {
+        ++count;
+    }
+    return count;
+}
+
+int wl_list_empty(const wl_list *list)
+{
+    return list->next == list;
+}
+
+void wl_list_insert_list(wl_list *list, wl_list *other)
+{
+    if (wl_list_empty(other)) {
+        return;
+    }
+    other->next->prev = list;
+    other->prev->next = list->next;
+    list->next->prev = other->prev;
+    list->next = other->next;
+}
+
+void weston_matrix_init(weston_matrix *matrix)
+{
+    static const weston_matrix identity = {
+        { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 },
+        0
+    };
+    *matrix = identity;
+}
+
+void weston_matrix_scale(weston_matrix *matrix, float x, float y, float z)
+{
+    for (int i = 0; i < 4; ++i) {
+        matrix->d[i * 4] *= x;
+        matrix->d[i * 4 + 1] *= y;
+        matrix->d[i * 4 + 2] *= z;
+    }
+    matrix->type |= WESTON_MATRIX_TRANSFORM_SCALE;
+}
+
+void weston_matrix_translate(weston_matrix *matrix, float x, float y, float z)
+{
+    for (int i = 0; i < 4; ++i) {
+        float w = matrix->d[i * 4 + 3];
+        matrix->d[i * 4] += x * w;
+        matrix->d[i * 4 + 1] += y * w;
+        matrix->d[i * 4 + 2] += z * w;
+    }
+    matrix->type |= WESTON_MATRIX_TRANSFORM_TRANSLATE;
+}
+
+void weston_layer_init(weston_layer *layer, wl_list *below)
+{
+    wl_list_init(&layer->view_list.link);
+    layer->view_list.layer = layer;
+    if (below) {
+        wl_list_insert(below, &layer->link);
+    }
+}
+
+void weston_layer_entry_insert(weston_layer_entry *list, weston_layer_entry *entry)
+{
+    wl_list_insert(&list->link, &entry->link);
+    entry->layer = list->layer;
+}
+
+void weston_layer_entry_remove(weston_layer_entry *entry)
+{
+    wl_list_remove(&entry->link);
+    wl_list_init(&entry->link);
+    entry->layer = nullptr;
+}
+
+weston_surface *weston_surface_create(weston_compositor *compositor)
+{
+    weston_surface *surface = new weston_surface;
+    memset(surface, 0, sizeof(*surface));
+    surface->compositor = compositor;
+    surface->ref_count = 1;
+    wl_signal_init(&surface->destroy_signal);
+    wl_list_init(&surface->views);
+    pixman_region32_init(&surface->damage);
+    pixman_region32_init(&surface->opaque);
+    pixman_region32_init(&surface->input);
+    return surface;
+}
+
+void weston_surface_destroy(weston_surface *surface)
+{
+    wl_signal_emit(&surface->destroy_signal, surface);
+
+    weston_view *view, *next;
+    wl_list_for_each_safe(view, next, &surface->views, surface_link) {
+        weston_view_destroy(view);
+    }
+    pixman_region32_fini(&surface->damage);
+    pixman_region32_fini(&surface->opaque);
+    pixman_region32_fini(&surface->input);
+    delete surface;
+}
+
+void weston_surface_damage(weston_surface *surface)
+{
+    ++s_damages;
+    weston_surface_schedule_repaint(surface);
+}
+
+void weston_surface_schedule_repaint(weston_surface *surface)
+{
+    weston_compositor_schedule_repaint(surface->compositor);
+}
+
+void weston_surface_set_color(weston_surface *surface, float red, float green, float blue, float alpha)
+{
+}
+
+weston_view *weston_view_create(weston_surface *surface)
+{
+    weston_view *view = new weston_view;
+    memset(view, 0, sizeof(*view));
+    ++s_views;
+    view->surface = surface;
+    wl_list_insert(&surface->views, &view->surface_link);
+    wl_signal_init(&view->destroy_signal);
+    wl_list_init(&view->link);
+    wl_list_init(&view->layer_link.link);
+    view->alpha = 1.f;
+    wl_list_init(&view->geometry.transformation_list);
+    wl_list_insert(&view->geometry.transformation_list, &view->transform.position.link);
+    weston_matrix_init(&view->transform.position.matrix);
+    wl_list_init(&view->geometry.child_list);
+    wl_list_init(&view->geometry.parent_link);
+    pixman_region32_init(&view->transform.boundingbox);
+    pixman_region32_init(&view->transform.opaque);
+    return view;
+}
+
+void weston_view_destroy(weston_view *view)
+{
+    wl_signal_emit(&view->destroy_signal, view);
+
+    weston_view *child, *next;
+    wl_list_for_each_safe(child, next, &view->geometry.child_list, geometry.parent_link) {
+        weston_view_set_transform_parent(child, nullptr);
+    }
+    weston_view_set_transform_parent(view, nullptr);
+    weston_layer_entry_remove(&view->layer_link);
+    wl_list_remove(&view->surface_link);
+    pixman_region32_fini(&view->transform.boundingbox);
+    pixman_region32_fini(&view->transform.opaque);
+    --s_views;
+    delete view;
+}
+
+void weston_view_damage_below(weston_view *view)
+{
+    ++s_damages;
+    weston_view_schedule_repaint(view);
+}
+
+void weston_view_schedule_repaint(weston_view *view)
+{
+    weston_compositor_schedule_repaint(view->surface->compositor);
+}
+
+void weston_view_geometry_dirty(weston_view *view)
+{
+    view->transform.dirty = 1;
+    weston_view *child;
+    wl_list_for_each(child, &view->geometry.child_list, geometry.parent_link) {
+        weston_view_geometry_dirty(child);
+    }
+}
+
+void weston_view_set_position(weston_view *view, float x, float y)
+{
+    view->geometry.x = x;
+    view->geometry.y = y;
+    weston_view_geometry_dirty(view);
+}
+
+void weston_view_set_transform_parent(weston_view *view, weston_view *parent)
+{
+    wl_list_remove(&view->geometry.parent_link);
+    wl_list_init(&view->geometry.parent_link);
+    view->geometry.parent = parent;
+    if (parent) {
+        wl_list_insert(&parent->geometry.child_list, &view->geometry.parent_link);
+    }
+    weston_view_geometry_dirty(view);
+}
+
+void weston_compositor_schedule_repaint(weston_compositor *compositor)
+{
+    ++s_scheduledRepaints;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAKEWESTON_H
+#define FAKEWESTON_H
+
+#include <stdint.h>
+
+struct weston_compositor;
+struct weston_output;
+struct weston_view;
+struct wl_event_loop;
+
+/*
+ * Stands in for the compositor, so that the classes which only need a
+ * few of its functions can be tested without one. It provides the log
+ * and the compositor time, which only moves when told to, and outputs
+ * which are just the structure with a mode. It also provides wl_list and
+ * an event loop whose timers go by the compositor time, and which only
+ * dispatches when told to.
+ * The surfaces and views are kept in the layers like weston does, but
+ * nothing is drawn: the damage and the repaints are only counted, and
+ * the animations of an output run when repaint() is called.
+ */
+class FakeWeston
+{
+public:
+    static void setTime(uint32_t msecs);
+    static uint32_t time();
+    /*
+     * The number of times weston_log() was called.
+     */
+    static int logCount();
+
+    /*
+     * The refresh is in mHz, like in weston_mode.
+     */
+    static weston_output *createOutput(int32_t refresh);
+    static void destroyOutput(weston_output *output);
+    /*
+     * The compositor of all the outputs, with its layer list, where the
+     * cursor layer is the only layer at first.
+     */
+    static weston_compositor *compositor();
+
+    /*
+     * A view of a new surface, to be destroyed with
+     * weston_surface_destroy(view->surface).
+     */
+    static weston_view *createView(int32_t width, int32_t height);
+    /*
+     * The number of views alive.
+     */
+    static int views();
+    /*
+     * The number of times a surface or a view was damaged, and a repaint
+     * scheduled, counting from the start.
+     */
+    static int damages();
+    static int scheduledRepaints();
+
+    /*
+     * Sets the time and runs the animations of output, as weston does
+     * when a frame of output was presented at msecs.
+     */
+    static void repaint(weston_output *output, uint32_t msecs);
+
+    /*
+     * Calls the idle sources, and then the timers which are due.
+     */
+    static void dispatch(wl_event_loop *loop);
+    /*
+     * The number of timer sources alive, and the number of times the
+     * timers were armed, both counting from the start.
+     */
+    static int timerSources();
+    static int timerUpdates();
+};
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "layer.h"
+#include "fake/fakeweston.h"
+#include "test.h"
+
+// The views of layer, from the top.
+static std::vector<weston_view *> views(const Layer &layer)
+{
+    std::vector<weston_view *> list;
+    for (weston_view *v: layer) {
+        list.push_back(v);
+    }
+    return list;
+}
+
+// The layers of the compositor below the cursor one, from the top.
+static std::vector<weston_layer *> layers()
+{
+    weston_compositor *ec = FakeWeston::compositor();
+    std::vector<weston_layer *> list;
+    weston_layer *l;
+    wl_list_for_each(l, &ec->layer_list, link) {
+        if (l != &ec->cursor_layer) {
+            list.push_back(l);
+        }
+    }
+    return list;
+}
+
+static weston_layer *nativeLayer(const Layer &layer)
+{
+    weston_view *v = *layer.begin();
+    return v->layer_link.layer;
+}
+
+static void testStacking()
+{
+    Layer layer;
+    weston_view *a = FakeWeston::createView(10, 10);
+    weston_view *b = FakeWeston::createView(10, 10);
+    weston_view *c = FakeWeston::createView(10, 10);
+
+    CHECK(layer.isEmpty());
+    layer.addSurface(a);
+    layer.addSurface(b);
+    layer.addSurface(c);
+    CHECK(!layer.isEmpty());
+    CHECK(layer.numberOfSurfaces() == 3);
+    CHECK((views(layer) == std::vector<weston_view *>{ c, b, a }));
+
+    std::vector<weston_view *> reversed;
+    for (Layer::iterator i = layer.rbegin(); i != layer.end(); ++i) {
+        reversed.push_back(*i);
+    }
+    CHECK((reversed == std::vector<weston_view *>{ a, b, c }));
+
+    int damages = FakeWeston::damages();
+    layer.restack(a);
+    CHECK((views(layer) == std::vector<weston_view *>{ a, c, b }));
+    CHECK(FakeWeston::damages() > damages);
+
+    layer.stackAbove(b, c);
+    CHECK((views(layer) == std::vector<weston_view *>{ a, b, c }));
+    layer.stackBelow(a, c);
+    CHECK((views(layer) == std::vector<weston_view *>{ b, c, a }));
+
+    // Adding a view again only moves it to the top.
+    layer.addSurface(c);
+    CHECK((views(layer) == std::vector<weston_view *>{ c, b, a }));
+
+    // A view added to another layer leaves this one.
+    Layer other;
+    other.addSurface(b);
+    CHECK((views(layer) == std::vector<weston_view *>{ c, a }));
+    CHECK((views(other) == std::vector<weston_view *>{ b }));
+
+    weston_surface_destroy(a->surface);
+    weston_surface_destroy(b->surface);
+    weston_surface_destroy(c->surface);
+    CHECK(layer.isEmpty());
+    CHECK(other.isEmpty());
+}
+
+static void testRemoveWhileIterating()
+{
+    Layer layer;
+    for (int i = 0; i < 5; ++i) {
+        layer.addSurface(FakeWeston::createView(10, 10));
+    }
+
+    int count = 0;
+    for (weston_view *v: layer) {
+        weston_surface_destroy(v->surface);
+        ++count;
+    }
+    CHECK(count == 5);
+    CHECK(layer.isEmpty());
+}
+
+static void testShowHide()
+{
+    weston_compositor *ec = FakeWeston::compositor();
+    weston_view *va = FakeWeston::createView(10, 10);
+    weston_view *vb = FakeWeston::createView(10, 10);
+    weston_view *vc = FakeWeston::createView(10, 10);
+
+    Layer a, b, c;
+    a.addSurface(va);
+    b.addSurface(vb);
+    c.addSurface(vc);
+    weston_layer *la = nativeLayer(a);
+    weston_layer *lb = nativeLayer(b);
+    weston_layer *lc = nativeLayer(c);
+
+    CHECK(!a.isVisible());
+    a.insert(&ec->cursor_layer);
+    b.insert(&a);
+    c.insert(&b);
+    CHECK(a.isVisible());
+    CHECK((layers() == std::vector<weston_layer *>{ la, lb, lc }));
+
+    // Hidden layers go back where they were.
+    b.hide();
+    CHECK(!b.isVisible());
+    CHECK((layers() == std::vector<weston_layer *>{ la, lc }));
+    b.show();
+    CHECK(b.isVisible());
+    CHECK((layers() == std::vector<weston_layer *>{ la, lb, lc }));
+
+    // A removed one does not.
+    b.remove();
+    b.show();
+    CHECK(!b.isVisible());
+    b.insert(&c);
+
+    // A layer without views is not visible, even if it is in the list.
+    Layer empty;
+    empty.insert(&c);
+    CHECK(!empty.isVisible());
+
+    weston_surface_destroy(va->surface);
+    weston_surface_destroy(vb->surface);
+    weston_surface_destroy(vc->surface);
+    a.remove();
+    b.remove();
+    c.remove();
+    empty.remove();
+    CHECK(layers().empty());
+}
+
+static void testTakeLayersBelow()
+{
+    weston_compositor *ec = FakeWeston::compositor();
+    weston_view *va = FakeWeston::createView(10, 10);
+    weston_view *vb = FakeWeston::createView(10, 10);
+    weston_view *vc = FakeWeston::createView(10, 10);
+
+    Layer a, b, c;
+    a.addSurface(va);
+    b.addSurface(vb);
+    c.addSurface(vc);
+    weston_layer *la = nativeLayer(a);
+    weston_layer *lb = nativeLayer(b);
+    weston_layer *lc = nativeLayer(c);
+    a.insert(&ec->cursor_layer);
+    b.insert(&a);
+    c.insert(&b);
+
+    wl_list taken;
+    a.takeLayersBelow(ec, &taken);
+    CHECK((layers() == std::vector<weston_layer *>{ la }));
+    CHECK(wl_list_length(&taken) == 2);
+
+    // The taken layers can still be hidden and shown meanwhile.
+    c.hide();
+    CHECK(wl_list_length(&taken) == 1);
+    c.show();
+    CHECK(wl_list_length(&taken) == 2);
+
+    a.restoreLayersBelow(&taken);
+    CHECK(wl_list_empty(&taken));
+    CHECK((layers() == std::vector<weston_layer *>{ la, lb, lc }));
+
+    // Nothing below the last layer.
+    c.takeLayersBelow(ec, &taken);
+    CHECK(wl_list_empty(&taken));
+    CHECK((layers() == std::vector<weston_layer *>{ la, lb, lc }));
+
+    weston_surface_destroy(va->surface);
+    weston_surface_destroy(vb->surface);
+    weston_surface_destroy(vc->surface);
+    a.remove();
+    b.remove();
+    c.remove();
+}
+
+int main()
+{
+    testStacking();
+    testRemoveWhileIterating();
+    testShowHide();
+    testTakeLayersBelow();
+
+    CHECK(FakeWeston::views() == 0);
+    return s_failures;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "objectstats.h"
+#include "test.h"
+
+class Object : public Counted<Object>
+{
+public:
+    char data[24];
+};
+
+static ObjectStats::Counter *counter()
+{
+    return ObjectStats::counter(ObjectStats::typeName(typeid(Object)));
+}
+
+static void testTypeName()
+{
+    CHECK(ObjectStats::typeName(typeid(Object)) == "Object");
+}
+
+static void testCounted()
+{
+    Object *a = new Object;
+    Object *b = new Object;
+    Object *c = new Object(*b);
+    CHECK(counter()->count() == 3);
+    CHECK(counter()->bytes() == 3 * sizeof(Object));
+
+    delete c;
+    delete b;
+    CHECK(counter()->count() == 1);
+    CHECK(counter()->peak() == 3);
+    CHECK(counter()->bytes() == sizeof(Object));
+
+    delete a;
+    CHECK(counter()->count() == 0);
+    CHECK(counter()->bytes() == 0);
+}
+
+static void testForEach()
+{
+    ObjectStats::counter("test");
+    bool found = false;
+    ObjectStats::forEach([&found](const std::string &name, const ObjectStats::Counter &c) {
+        if (name == "test") {
+            found = true;
+        }
+    });
+    CHECK(found);
+}
+
+int main()
+{
+    testTypeName();
+    testCounted();
+    testForEach();
+    return s_failures;
+}
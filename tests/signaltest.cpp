@@ -0,0 +1,126 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shellsignal.h"
+#include "test.h"
+
+class Receiver
+{
+public:
+    Receiver() : calls(0), sum(0) {}
+
+    void received(int a, int b)
+    {
+        ++calls;
+        sum += a + b;
+    }
+
+    int calls;
+    int sum;
+};
+
+class SelfDisconnecting
+{
+public:
+    SelfDisconnecting(Signal<int, int> *s) : signal(s), calls(0) {}
+
+    void received(int, int)
+    {
+        ++calls;
+        signal->disconnect(this, &SelfDisconnecting::received);
+    }
+
+    Signal<int, int> *signal;
+    int calls;
+};
+
+static int slots()
+{
+    return ObjectStats::counter("Signal slot")->count();
+}
+
+static void testConnect()
+{
+    Signal<int, int> signal;
+    Receiver r;
+    signal.connect(&r, &Receiver::received);
+    // Connecting the same member twice does nothing.
+    signal.connect(&r, &Receiver::received);
+    CHECK(signal.isConnected(&r, &Receiver::received));
+
+    signal(1, 2);
+    CHECK(r.calls == 1);
+    CHECK(r.sum == 3);
+
+    int calls = 0;
+    signal.connect([&calls](int a, int b) { ++calls; });
+    signal(3, 4);
+    CHECK(r.calls == 2);
+    CHECK(r.sum == 10);
+    CHECK(calls == 1);
+}
+
+static void testDisconnect()
+{
+    Signal<int, int> signal;
+    Receiver r;
+    signal.connect(&r, &Receiver::received);
+    signal.disconnect(&r, &Receiver::received);
+    CHECK(!signal.isConnected(&r, &Receiver::received));
+    signal(1, 2);
+    CHECK(r.calls == 0);
+}
+
+static void testDisconnectWhileCalled()
+{
+    Signal<int, int> signal;
+    SelfDisconnecting s(&signal);
+    Receiver r;
+    signal.connect(&s, &SelfDisconnecting::received);
+    signal.connect(&r, &Receiver::received);
+
+    // The slots after the removed one are still called, once.
+    signal(1, 2);
+    CHECK(s.calls == 1);
+    CHECK(r.calls == 1);
+
+    signal(1, 2);
+    CHECK(s.calls == 1);
+    CHECK(r.calls == 2);
+}
+
+static void testSlotsFreed()
+{
+    int before = slots();
+    {
+        Signal<int, int> signal;
+        Receiver r;
+        signal.connect(&r, &Receiver::received);
+        signal.connect([](int, int) {});
+        CHECK(slots() == before + 2);
+    }
+    CHECK(slots() == before);
+}
+
+int main()
+{
+    testConnect();
+    testDisconnect();
+    testDisconnectWhileCalled();
+    testSlotsFreed();
+    return s_failures;
+}
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Runs the soak driver as the shell client of a headless weston and fails
+# when it does, or when it does not finish in time.
+#
+# Usage: soak.sh <weston> <nuclear-desktop-shell.so> <nuclear-soak> <weston-test.so>
+#
+# The headless backend has no input devices, weston's test module gives it
+# a seat for the popups and the activation of the windows.
+#
+# The duration and the thresholds are passed in the environment, see
+# soakclient.cpp.
+
+weston="$1"
+shell="$2"
+client="$3"
+module="$4"
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# Keep the configuration of the user out of it.
+export XDG_CONFIG_HOME="$dir"
+export XDG_CONFIG_DIRS="$dir"
+export XDG_RUNTIME_DIR="${XDG_RUNTIME_DIR:-$dir}"
+export NUCLEAR_SOAK_RESULT="$dir/result"
+
+"$weston" --backend=headless-backend.so --shell="$shell" --nuclear-client="$client" \
+          --modules="$module" --socket="nuclear-soak-$$" --log="$dir/weston.log" &
+pid=$!
+
+# The driver quits the compositor when it is done, leave some time on top
+# of the duration to start and to quit.
+timeout=$((${NUCLEAR_SOAK_DURATION:-60} + 120))
+while kill -0 $pid 2>/dev/null && [ $timeout -gt 0 ]; do
+    sleep 1
+    timeout=$((timeout - 1))
+done
+if kill -0 $pid 2>/dev/null; then
+    echo "nuclear-soak: did not finish in time"
+    kill $pid
+fi
+wait $pid
+
+cat "$dir/weston.log"
+if [ ! -f "$NUCLEAR_SOAK_RESULT" ]; then
+    echo "nuclear-soak: no result"
+    exit 1
+fi
+cat "$NUCLEAR_SOAK_RESULT"
+[ "$(head -n 1 "$NUCLEAR_SOAK_RESULT")" = "PASS" ]
@@ -0,0 +1,579 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <wayland-client.h>
+
+#include "wayland-desktop-shell-client-protocol.h"
+#include "wayland-xdg-shell-client-protocol.h"
+#include "wayland-stats-client-protocol.h"
+
+/*
+ * The soak test driver. It is launched by the shell as its client, with
+ * --nuclear-client, which is what lets it query the stats interface. For
+ * the configured duration it keeps creating and destroying wl_shell and
+ * xdg windows, with transients and popups, while adding, selecting and
+ * removing workspaces and minimizing and restoring all the windows. Then
+ * it checks the p99 latencies, which must all have samples, and the growth
+ * of the resident size of the compositor since the first time all the
+ * windows were up, writes the result to a file and quits the compositor.
+ * The compositor needs a seat, for the popups and the activation.
+ *
+ * Configured with environment variables, which the shell client inherits:
+ * NUCLEAR_SOAK_DURATION, in seconds, NUCLEAR_SOAK_WINDOWS, the number of
+ * windows open at once, NUCLEAR_SOAK_MAX_P99_US, NUCLEAR_SOAK_MAX_RSS_GROWTH_KB
+ * and NUCLEAR_SOAK_RESULT, the file where "PASS" or "FAIL" is written
+ * followed by the measurements.
+ */
+
+static const int BufferSize = 64;
+// Windows created and destroyed in every cycle.
+static const int Batch = 50;
+
+static int envInt(const char *name, int def)
+{
+    const char *v = getenv(name);
+    return v && *v ? atoi(v) : def;
+}
+
+static uint64_t currentTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+class Soak;
+
+class Surface
+{
+public:
+    Surface() : surface(nullptr), shellSurface(nullptr), xdgSurface(nullptr), xdgPopup(nullptr) {}
+    void destroy();
+
+    wl_surface *surface;
+    wl_shell_surface *shellSurface;
+    xdg_surface *xdgSurface;
+    xdg_popup *xdgPopup;
+};
+
+/*
+ * A toplevel and maybe a transient or a popup of it, which is destroyed
+ * first.
+ */
+struct Window
+{
+    Surface toplevel;
+    Surface child;
+};
+
+class Soak
+{
+public:
+    Soak();
+    ~Soak();
+
+    bool init();
+    int run();
+
+private:
+    enum class Kind {
+        WlShell,
+        Xdg,
+        WlShellTransient,
+        XdgTransient,
+        WlShellPopup,
+        XdgPopup
+    };
+
+    bool createBuffer();
+    void createWindow(Kind kind);
+    void createSurface(Surface *s, bool xdg);
+    void commit(Surface *s);
+    void cycle();
+    void churnWorkspaces();
+    std::map<std::string, int> query(const char *category);
+    bool check(std::string *report);
+    void finish(bool ok, const std::string &report);
+
+    wl_display *m_display;
+    wl_registry *m_registry;
+    wl_compositor *m_compositor;
+    wl_shm *m_shm;
+    wl_shell *m_shell;
+    wl_seat *m_seat;
+    xdg_shell *m_xdgShell;
+    desktop_shell *m_desktopShell;
+    nuclear_stats *m_stats;
+    wl_buffer *m_buffer;
+
+    std::list<Window *> m_windows;
+    std::vector<desktop_shell_workspace *> m_workspaces;
+    desktop_shell_workspace *m_newWorkspace;
+    int m_cycle;
+    int m_created;
+    bool m_running;
+
+    int m_duration;
+    int m_windowCount;
+    int m_maxP99;
+    int m_maxRssGrowth;
+    int m_baseRss;
+
+    std::map<std::string, int> m_entries;
+    bool m_queryDone;
+
+    static const wl_registry_listener s_registryListener;
+    static const wl_shell_surface_listener s_shellSurfaceListener;
+    static const xdg_surface_listener s_xdgSurfaceListener;
+    static const xdg_popup_listener s_xdgPopupListener;
+    static const desktop_shell_listener s_desktopShellListener;
+    static const desktop_shell_window_listener s_windowListener;
+    static const nuclear_stats_listener s_statsListener;
+};
+
+void Surface::destroy()
+{
+    if (shellSurface) {
+        wl_shell_surface_destroy(shellSurface);
+    }
+    if (xdgSurface) {
+        xdg_surface_destroy(xdgSurface);
+    }
+    if (xdgPopup) {
+        xdg_popup_destroy(xdgPopup);
+    }
+    if (surface) {
+        wl_surface_destroy(surface);
+    }
+    *this = Surface();
+}
+
+Soak::Soak()
+    : m_display(nullptr)
+    , m_registry(nullptr)
+    , m_compositor(nullptr)
+    , m_shm(nullptr)
+    , m_shell(nullptr)
+    , m_seat(nullptr)
+    , m_xdgShell(nullptr)
+    , m_desktopShell(nullptr)
+    , m_stats(nullptr)
+    , m_buffer(nullptr)
+    , m_newWorkspace(nullptr)
+    , m_cycle(0)
+    , m_created(0)
+    , m_running(false)
+    , m_duration(envInt("NUCLEAR_SOAK_DURATION", 60))
+    , m_windowCount(envInt("NUCLEAR_SOAK_WINDOWS", 1000))
+    , m_maxP99(envInt("NUCLEAR_SOAK_MAX_P99_US", 20000))
+    , m_maxRssGrowth(envInt("NUCLEAR_SOAK_MAX_RSS_GROWTH_KB", 20480))
+    , m_baseRss(-1)
+    , m_queryDone(false)
+{
+}
+
+Soak::~Soak()
+{
+    for (Window *w: m_windows) {
+        w->child.destroy();
+        w->toplevel.destroy();
+        delete w;
+    }
+    if (m_display) {
+        wl_display_disconnect(m_display);
+    }
+}
+
+bool Soak::init()
+{
+    m_display = wl_display_connect(nullptr);
+    if (!m_display) {
+        fprintf(stderr, "nuclear-soak: cannot connect to the compositor\n");
+        return false;
+    }
+    m_registry = wl_display_get_registry(m_display);
+    wl_registry_add_listener(m_registry, &s_registryListener, this);
+    wl_display_roundtrip(m_display);
+
+    if (!m_compositor || !m_shm || !m_shell || !m_xdgShell || !m_desktopShell || !m_stats) {
+        fprintf(stderr, "nuclear-soak: missing globals, is it running as the shell client?\n");
+        return false;
+    }
+    if (!m_seat) {
+        // Headless has none unless a module adds one, see soak.sh.
+        finish(false, "FAILED: no seat, the popups and the activation would not be tested\n");
+        return false;
+    }
+    xdg_shell_use_unstable_version(m_xdgShell, XDG_SHELL_VERSION_CURRENT);
+    desktop_shell_add_listener(m_desktopShell, &s_desktopShellListener, this);
+    nuclear_stats_add_listener(m_stats, &s_statsListener, this);
+    desktop_shell_desktop_ready(m_desktopShell);
+
+    if (!createBuffer()) {
+        return false;
+    }
+    // Get the existing workspaces, and add a second one to move between if
+    // there is only one.
+    wl_display_roundtrip(m_display);
+    if (m_workspaces.size() < 2) {
+        desktop_shell_add_workspace(m_desktopShell);
+        wl_display_roundtrip(m_display);
+    }
+    m_running = true;
+    return !m_workspaces.empty();
+}
+
+bool Soak::createBuffer()
+{
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    std::string path = std::string(dir ? dir : "/tmp") + "/nuclear-soak-XXXXXX";
+    int fd = mkostemp(&path[0], O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "nuclear-soak: cannot create the buffer file: %m\n");
+        return false;
+    }
+    unlink(path.c_str());
+
+    int stride = BufferSize * 4;
+    int size = stride * BufferSize;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    memset(data, 0x80, size);
+    munmap(data, size);
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd, size);
+    // All the surfaces show the same buffer, it is never written again.
+    m_buffer = wl_shm_pool_create_buffer(pool, 0, BufferSize, BufferSize, stride, WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return true;
+}
+
+void Soak::createSurface(Surface *s, bool xdg)
+{
+    s->surface = wl_compositor_create_surface(m_compositor);
+    if (xdg) {
+        s->xdgSurface = xdg_shell_get_xdg_surface(m_xdgShell, s->surface);
+        xdg_surface_add_listener(s->xdgSurface, &s_xdgSurfaceListener, this);
+        xdg_surface_set_title(s->xdgSurface, "soak");
+        xdg_surface_set_app_id(s->xdgSurface, "nuclear-soak");
+    } else {
+        s->shellSurface = wl_shell_get_shell_surface(m_shell, s->surface);
+        wl_shell_surface_add_listener(s->shellSurface, &s_shellSurfaceListener, this);
+        wl_shell_surface_set_title(s->shellSurface, "soak");
+    }
+}
+
+void Soak::commit(Surface *s)
+{
+    wl_surface_attach(s->surface, m_buffer, 0, 0);
+    wl_surface_damage(s->surface, 0, 0, BufferSize, BufferSize);
+    wl_surface_commit(s->surface);
+}
+
+void Soak::createWindow(Kind kind)
+{
+    Window *w = new Window;
+    bool xdg = kind == Kind::Xdg || kind == Kind::XdgTransient || kind == Kind::XdgPopup;
+    createSurface(&w->toplevel, xdg);
+    if (w->toplevel.shellSurface) {
+        wl_shell_surface_set_toplevel(w->toplevel.shellSurface);
+    }
+    commit(&w->toplevel);
+
+    Surface *c = &w->child;
+    switch (kind) {
+        case Kind::WlShellTransient:
+            createSurface(c, false);
+            wl_shell_surface_set_transient(c->shellSurface, w->toplevel.surface, 20, 20, 0);
+            break;
+        case Kind::XdgTransient:
+            createSurface(c, true);
+            xdg_surface_set_transient_for(c->xdgSurface, w->toplevel.surface);
+            break;
+        case Kind::WlShellPopup:
+            createSurface(c, false);
+            wl_shell_surface_set_popup(c->shellSurface, m_seat, 0, w->toplevel.surface, 10, 10, 0);
+            break;
+        case Kind::XdgPopup:
+            c->surface = wl_compositor_create_surface(m_compositor);
+            c->xdgPopup = xdg_shell_get_xdg_popup(m_xdgShell, c->surface, w->toplevel.surface, m_seat, 0, 10, 10, 0);
+            xdg_popup_add_listener(c->xdgPopup, &s_xdgPopupListener, this);
+            break;
+        default:
+            break;
+    }
+    if (c->surface) {
+        commit(c);
+    }
+
+    m_windows.push_back(w);
+    ++m_created;
+}
+
+void Soak::cycle()
+{
+    static const Kind kinds[] = { Kind::WlShell, Kind::Xdg, Kind::WlShellTransient, Kind::XdgTransient,
+                                  Kind::WlShellPopup, Kind::XdgPopup };
+    static const int numKinds = sizeof(kinds) / sizeof(kinds[0]);
+
+    // Spread the windows over the workspaces.
+    desktop_shell_select_workspace(m_desktopShell, m_workspaces[m_cycle % m_workspaces.size()]);
+
+    for (int i = 0; i < Batch; ++i) {
+        createWindow(kinds[m_created % numKinds]);
+    }
+    while ((int)m_windows.size() > m_windowCount) {
+        Window *w = m_windows.front();
+        m_windows.pop_front();
+        w->child.destroy();
+        w->toplevel.destroy();
+        delete w;
+    }
+
+    churnWorkspaces();
+    if (m_cycle % 4 == 0) {
+        // Runs the minimize effect on all the windows, both ways.
+        desktop_shell_minimize_windows(m_desktopShell);
+        wl_display_roundtrip(m_display);
+        desktop_shell_restore_windows(m_desktopShell);
+    }
+    ++m_cycle;
+}
+
+void Soak::churnWorkspaces()
+{
+    desktop_shell_add_workspace(m_desktopShell);
+    wl_display_roundtrip(m_display);
+    if (!m_newWorkspace) {
+        return;
+    }
+    // Remove it while it is empty, after switching to it and back.
+    desktop_shell_select_workspace(m_desktopShell, m_newWorkspace);
+    desktop_shell_select_workspace(m_desktopShell, m_workspaces[0]);
+    desktop_shell_workspace_remove(m_newWorkspace);
+    desktop_shell_workspace_destroy(m_newWorkspace);
+    m_newWorkspace = nullptr;
+}
+
+std::map<std::string, int> Soak::query(const char *category)
+{
+    m_entries.clear();
+    m_queryDone = false;
+    nuclear_stats_query(m_stats, category);
+    while (!m_queryDone && wl_display_dispatch(m_display) >= 0) {
+    }
+    return m_entries;
+}
+
+bool Soak::check(std::string *report)
+{
+    bool ok = true;
+    char line[256];
+
+    std::map<std::string, int> latency = query("latency");
+    for (auto &i: latency) {
+        snprintf(line, sizeof(line), "latency %s = %d\n", i.first.c_str(), i.second);
+        *report += line;
+        size_t pos = i.first.rfind("/p99_us");
+        if (pos == std::string::npos || pos + 7 != i.first.size()) {
+            continue;
+        }
+        // A p99 of nothing is 0, which would pass.
+        std::string object = i.first.substr(0, pos);
+        auto samples = latency.find(object + "/samples");
+        if (samples == latency.end() || samples->second == 0) {
+            snprintf(line, sizeof(line), "FAILED: no samples of %s\n", object.c_str());
+            *report += line;
+            ok = false;
+        } else if (i.second > m_maxP99) {
+            snprintf(line, sizeof(line), "FAILED: %s over %d us\n", i.first.c_str(), m_maxP99);
+            *report += line;
+            ok = false;
+        }
+    }
+
+    std::map<std::string, int> objects = query("objects");
+    int rss = objects["process/rss_kb"];
+    snprintf(line, sizeof(line), "windows created %d, cycles %d\nrss %d kB, at the start %d kB\n",
+             m_created, m_cycle, rss, m_baseRss);
+    *report += line;
+    if (rss - m_baseRss > m_maxRssGrowth) {
+        snprintf(line, sizeof(line), "FAILED: rss grew by more than %d kB\n", m_maxRssGrowth);
+        *report += line;
+        ok = false;
+    }
+    return ok;
+}
+
+int Soak::run()
+{
+    uint64_t start = currentTime();
+    while (currentTime() - start < (uint64_t)m_duration * 1000) {
+        cycle();
+        if (wl_display_roundtrip(m_display) < 0) {
+            fprintf(stderr, "nuclear-soak: lost the connection to the compositor\n");
+            return 1;
+        }
+        if (m_baseRss < 0 && (int)m_windows.size() >= m_windowCount) {
+            // Everything is allocated once all the windows are up, the growth
+            // after this is what could be a leak.
+            m_baseRss = query("objects")["process/rss_kb"];
+        }
+    }
+    if (m_baseRss < 0) {
+        fprintf(stderr, "nuclear-soak: %d windows were never reached, make the duration longer\n", m_windowCount);
+        m_baseRss = query("objects")["process/rss_kb"];
+    }
+
+    std::string report;
+    bool ok = check(&report);
+    finish(ok, report);
+    return ok ? 0 : 1;
+}
+
+void Soak::finish(bool ok, const std::string &report)
+{
+    fprintf(stderr, "nuclear-soak: %s%s", ok ? "PASS\n" : "FAIL\n", report.c_str());
+    if (const char *file = getenv("NUCLEAR_SOAK_RESULT")) {
+        if (FILE *f = fopen(file, "w")) {
+            fprintf(f, "%s\n%s", ok ? "PASS" : "FAIL", report.c_str());
+            fclose(f);
+        }
+    }
+
+    // Otherwise the shell would launch it again.
+    desktop_shell_quit(m_desktopShell);
+    wl_display_roundtrip(m_display);
+}
+
+const wl_registry_listener Soak::s_registryListener = {
+    [](void *data, wl_registry *registry, uint32_t id, const char *interface, uint32_t version) {
+        Soak *soak = static_cast<Soak *>(data);
+        if (strcmp(interface, "wl_compositor") == 0) {
+            soak->m_compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+        } else if (strcmp(interface, "wl_shm") == 0) {
+            soak->m_shm = static_cast<wl_shm *>(wl_registry_bind(registry, id, &wl_shm_interface, 1));
+        } else if (strcmp(interface, "wl_shell") == 0) {
+            soak->m_shell = static_cast<wl_shell *>(wl_registry_bind(registry, id, &wl_shell_interface, 1));
+        } else if (strcmp(interface, "wl_seat") == 0 && !soak->m_seat) {
+            soak->m_seat = static_cast<wl_seat *>(wl_registry_bind(registry, id, &wl_seat_interface, 1));
+        } else if (strcmp(interface, "xdg_shell") == 0) {
+            soak->m_xdgShell = static_cast<xdg_shell *>(wl_registry_bind(registry, id, &xdg_shell_interface, 1));
+        } else if (strcmp(interface, "desktop_shell") == 0) {
+            soak->m_desktopShell = static_cast<desktop_shell *>(wl_registry_bind(registry, id, &desktop_shell_interface, 1));
+        } else if (strcmp(interface, "nuclear_stats") == 0) {
+            soak->m_stats = static_cast<nuclear_stats *>(wl_registry_bind(registry, id, &nuclear_stats_interface, 1));
+        }
+    },
+    [](void *, wl_registry *, uint32_t) {}
+};
+
+const wl_shell_surface_listener Soak::s_shellSurfaceListener = {
+    [](void *, wl_shell_surface *s, uint32_t serial) { wl_shell_surface_pong(s, serial); },
+    [](void *, wl_shell_surface *, uint32_t, int32_t, int32_t) {},
+    [](void *, wl_shell_surface *) {}
+};
+
+const xdg_surface_listener Soak::s_xdgSurfaceListener = {
+    [](void *, xdg_surface *s, uint32_t serial) { xdg_surface_pong(s, serial); },
+    [](void *, xdg_surface *, uint32_t, int32_t, int32_t) {},
+    [](void *, xdg_surface *) {},
+    [](void *, xdg_surface *) {},
+    [](void *, xdg_surface *) {},
+    [](void *, xdg_surface *) {},
+    [](void *, xdg_surface *) {},
+    [](void *, xdg_surface *) {}
+};
+
+const xdg_popup_listener Soak::s_xdgPopupListener = {
+    [](void *, xdg_popup *p, uint32_t serial) { xdg_popup_pong(p, serial); },
+    [](void *, xdg_popup *, uint32_t) {}
+};
+
+const desktop_shell_listener Soak::s_desktopShellListener = {
+    // ping
+    [](void *, desktop_shell *shell, uint32_t serial) { desktop_shell_pong(shell, serial); },
+    // load
+    [](void *, desktop_shell *) {},
+    // configure
+    [](void *, desktop_shell *, uint32_t, wl_surface *, int32_t, int32_t) {},
+    // prepare_lock_surface, the screen may lock when it is idle
+    [](void *, desktop_shell *shell) { desktop_shell_unlock(shell); },
+    // grab_cursor
+    [](void *, desktop_shell *, uint32_t) {},
+    // window_added
+    [](void *data, desktop_shell *, desktop_shell_window *window, const char *, int32_t) {
+        desktop_shell_window_add_listener(window, &s_windowListener, data);
+    },
+    // workspace_added
+    [](void *data, desktop_shell *, desktop_shell_workspace *workspace, int32_t) {
+        Soak *soak = static_cast<Soak *>(data);
+        if (soak->m_running) {
+            soak->m_newWorkspace = workspace;
+        } else {
+            soak->m_workspaces.push_back(workspace);
+        }
+    },
+    // desktop_rect
+    [](void *, desktop_shell *, wl_output *, int32_t, int32_t, int32_t, int32_t) {}
+};
+
+const desktop_shell_window_listener Soak::s_windowListener = {
+    [](void *, desktop_shell_window *, const char *) {},
+    [](void *, desktop_shell_window *, int32_t) {},
+    [](void *, desktop_shell_window *window) { desktop_shell_window_destroy(window); }
+};
+
+const nuclear_stats_listener Soak::s_statsListener = {
+    [](void *, nuclear_stats *, const char *) {},
+    [](void *data, nuclear_stats *, const char *object, const char *key, int32_t value) {
+        static_cast<Soak *>(data)->m_entries[std::string(object) + "/" + key] = value;
+    },
+    [](void *data, nuclear_stats *, const char *) {
+        static_cast<Soak *>(data)->m_queryDone = true;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    Soak soak;
+    if (!soak.init()) {
+        return 1;
+    }
+    return soak.run();
+}
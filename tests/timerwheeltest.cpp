@@ -0,0 +1,164 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "utils.h"
+#include "fake/fakeweston.h"
+#include "test.h"
+
+static wl_event_loop *s_loop = nullptr;
+
+static uint64_t fakeClock()
+{
+    return FakeWeston::time();
+}
+
+static void runUntil(uint32_t time)
+{
+    FakeWeston::setTime(time);
+    FakeWeston::dispatch(s_loop);
+}
+
+class Probe
+{
+public:
+    Probe(int interval)
+        : timer(interval)
+        , fired(0)
+    {
+        timer.triggered.connect([this]() {
+            fired = FakeWeston::time();
+            timer.stop();
+        });
+    }
+
+    Timer timer;
+    uint32_t fired;
+};
+
+static void testExpire()
+{
+    // Around the ends of the levels, and one in the overflow list.
+    static const int intervals[] = { 1, 10, 63, 64, 100, 4095, 4096, 5000, 300000, 20000000 };
+    static const int count = sizeof(intervals) / sizeof(intervals[0]);
+
+    uint32_t start = FakeWeston::time();
+    std::vector<Probe *> probes;
+    for (int i = 0; i < count; ++i) {
+        probes.push_back(new Probe(intervals[i]));
+        probes.back()->timer.start();
+    }
+
+    // Jump from one expiry to the next, the timers further away are moved
+    // down the levels on the way.
+    for (int i = 0; i < count; ++i) {
+        runUntil(start + intervals[i] - 1);
+        CHECK(probes[i]->fired == 0);
+        runUntil(start + intervals[i]);
+        CHECK(probes[i]->fired == start + intervals[i]);
+        if (i + 1 < count) {
+            CHECK(probes[i + 1]->fired == 0);
+        }
+    }
+
+    for (Probe *p: probes) {
+        delete p;
+    }
+}
+
+static void testSkipAhead()
+{
+    uint32_t start = FakeWeston::time();
+    Probe a(10);
+    Probe b(5000);
+    Probe c(20000000);
+    a.timer.start();
+    b.timer.start();
+    c.timer.start();
+
+    // Hours later, all of them expire in one go.
+    runUntil(start + 30000000);
+    CHECK(a.fired == start + 30000000);
+    CHECK(b.fired == start + 30000000);
+    CHECK(c.fired == start + 30000000);
+}
+
+static void testArming()
+{
+    uint32_t start = FakeWeston::time();
+    int updates = FakeWeston::timerUpdates();
+    Probe a(10000);
+    Probe b(20000);
+    Probe c(100);
+
+    a.timer.start();
+    CHECK(FakeWeston::timerUpdates() == updates + 1);
+    // Expiring later than what the wheel is armed for does not arm it.
+    b.timer.start();
+    CHECK(FakeWeston::timerUpdates() == updates + 1);
+    c.timer.start();
+    CHECK(FakeWeston::timerUpdates() == updates + 2);
+
+    // Stopping and starting keeps the same source, and it is still armed.
+    a.timer.stop();
+    b.timer.stop();
+    c.timer.stop();
+    CHECK(FakeWeston::timerSources() == 1);
+    c.timer.start();
+    CHECK(FakeWeston::timerSources() == 1);
+    CHECK(FakeWeston::timerUpdates() == updates + 2);
+
+    runUntil(start + 100);
+    CHECK(c.fired == start + 100);
+    runUntil(start + 30000);
+    CHECK(a.fired == 0);
+    CHECK(b.fired == 0);
+}
+
+static void testStartFromHandler()
+{
+    uint32_t start = FakeWeston::time();
+    Probe a(10);
+    Probe b(5);
+    a.timer.triggered.connect([&b]() { b.timer.start(); });
+    a.timer.start();
+
+    runUntil(start + 10);
+    CHECK(a.fired == start + 10);
+    CHECK(b.fired == 0);
+    runUntil(start + 15);
+    CHECK(b.fired == start + 15);
+}
+
+int main()
+{
+    FakeWeston::setTime(1000);
+    s_loop = wl_event_loop_create();
+    TimerWheel::init(s_loop, fakeClock);
+    CHECK(FakeWeston::timerSources() == 1);
+
+    testExpire();
+    testSkipAhead();
+    testArming();
+    testStartFromHandler();
+
+    TimerWheel::cleanup();
+    CHECK(FakeWeston::timerSources() == 0);
+    wl_event_loop_destroy(s_loop);
+    return s_failures;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2013-2014 Giulio Camuffo <giuliocamuffo@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workspace.h"
+#include "fake/fakeweston.h"
+#include "fake/fakeshell.h"
+#include "test.h"
+
+static weston_layer *nativeLayer(weston_view *view)
+{
+    return view->layer_link.layer;
+}
+
+static bool isInCompositor(weston_layer *layer)
+{
+    weston_layer *l;
+    wl_list_for_each(l, &FakeWeston::compositor()->layer_list, link) {
+        if (l == layer) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static weston_view *background(weston_surface *surface)
+{
+    if (wl_list_empty(&surface->views)) {
+        return nullptr;
+    }
+    return container_of(surface->views.next, weston_view, surface_link);
+}
+
+static void testLayers(Shell *shell, weston_output *output)
+{
+    weston_compositor *ec = FakeWeston::compositor();
+    Workspace *ws = new Workspace(shell, 0);
+    CHECK(ws->number() == 0);
+    CHECK(ws->output() == output);
+    // The root view, which the surfaces are transformed with.
+    CHECK(ws->numberOfSurfaces() == 1);
+    weston_layer *layer = nativeLayer(*ws->layer().begin());
+
+    weston_view *bkg = FakeWeston::createView(output->width, output->height);
+    ws->createBackgroundView(bkg->surface, output);
+    weston_view *view = background(bkg->surface);
+    weston_layer *backgroundLayer = nativeLayer(view);
+    CHECK(backgroundLayer != layer);
+    CHECK(view->geometry.x == output->x);
+    CHECK(view->geometry.parent == *ws->layer().begin());
+
+    // The background goes in and out with the workspace, below it.
+    CHECK(!ws->layer().isVisible());
+    ws->insert(&ec->cursor_layer);
+    CHECK(ws->layer().isVisible());
+    CHECK(layer->link.prev == &ec->cursor_layer.link);
+    CHECK(backgroundLayer->link.prev == &layer->link);
+
+    ws->remove();
+    CHECK(!ws->layer().isVisible());
+    CHECK(!isInCompositor(layer));
+    CHECK(!isInCompositor(backgroundLayer));
+
+    // Destroying it takes its layers out of the compositor.
+    ws->insert(&ec->cursor_layer);
+    bool destroyed = false;
+    ws->destroyedSignal.connect([&destroyed](Workspace *) { destroyed = true; });
+    delete ws;
+    CHECK(destroyed);
+    CHECK(!isInCompositor(layer));
+    CHECK(!isInCompositor(backgroundLayer));
+
+    weston_surface_destroy(bkg->surface);
+}
+
+static void testBackground(Shell *shell, weston_output *output)
+{
+    Workspace ws(shell, 1);
+    weston_view *first = FakeWeston::createView(output->width, output->height);
+    weston_view *second = FakeWeston::createView(output->width, output->height);
+    int views = FakeWeston::views();
+
+    ws.createBackgroundView(first->surface, output);
+    CHECK(FakeWeston::views() == views + 1);
+    // A new background replaces the view of the old one.
+    ws.createBackgroundView(second->surface, output);
+    CHECK(FakeWeston::views() == views + 1);
+    CHECK(wl_list_length(&first->surface->views) == 1);
+    CHECK(wl_list_length(&second->surface->views) == 2);
+
+    // The workspace forgets the background when its surface goes away,
+    // and can take a new one.
+    weston_surface_destroy(second->surface);
+    CHECK(FakeWeston::views() == views - 1);
+    ws.createBackgroundView(first->surface, output);
+    CHECK(FakeWeston::views() == views);
+
+    weston_surface_destroy(first->surface);
+}
+
+static void testTransform(Shell *shell)
+{
+    Workspace ws(shell, 2);
+    weston_view *root = *ws.layer().begin();
+    root->transform.dirty = 0;
+
+    Transform tr;
+    tr.scale(0.5, 0.5, 1);
+    ws.setTransform(tr);
+    CHECK(root->transform.dirty);
+    CHECK(wl_list_length(&root->geometry.transformation_list) == 2);
+    weston_transform *t = container_of(root->geometry.transformation_list.next, weston_transform, link);
+    CHECK(t->matrix.d[0] == 0.5);
+
+    // Setting it again replaces it.
+    tr.reset();
+    ws.setTransform(tr);
+    CHECK(wl_list_length(&root->geometry.transformation_list) == 2);
+    CHECK(t->matrix.d[0] == 1);
+}
+
+static void testActive(Shell *shell)
+{
+    Workspace ws(shell, 3);
+    int changes = 0;
+    ws.activeChangedSignal.connect([&changes]() { ++changes; });
+
+    CHECK(!ws.isActive());
+    ws.setActive(true);
+    CHECK(ws.isActive());
+    CHECK(changes == 1);
+    ws.setActive(false);
+    CHECK(!ws.isActive());
+    CHECK(changes == 2);
+}
+
+int main()
+{
+    weston_output *output = FakeWeston::createOutput(60000);
+    output->x = 100;
+    output->width = 800;
+    output->height = 600;
+    FakeShell *shell = new FakeShell(FakeWeston::compositor());
+
+    testLayers(shell, output);
+    testBackground(shell, output);
+    testTransform(shell);
+    testActive(shell);
+
+    delete shell;
+    FakeWeston::destroyOutput(output);
+    CHECK(FakeWeston::views() == 0);
+    return s_failures;
+}